@@ -41,6 +41,18 @@ _ALLOWED_DLL_CALLS = frozenset({
 
 AudioChunk = Tuple[bytes, Optional[Any], bool, int]
 
+# Marker slots per eloq_read_batch call
+_MAX_BATCH_MARKERS = 64
+
+
+class ELOQ_MARKER(ctypes.Structure):
+	"""Marker record filled by eloq_read_batch (mirrors the C struct)."""
+	_fields_ = [
+		("type", ctypes.c_int),
+		("value", ctypes.c_int),
+		("byteOffset", ctypes.c_int),
+	]
+
 
 # ---------------------------------------------------------------------------
 # AudioWorker (pulls audio from queue and feeds to nvwave.WavePlayer)
@@ -166,6 +178,10 @@ class EloquenceClient:
 		self._audio_buf = None
 		self._out_type = None
 		self._out_value = None
+		self._has_read_wait = False
+		self._has_read_batch = False
+		self._markers = None
+		self._num_markers = None
 
 	def do_initialize(self, dll_path: str, engine_dir: str) -> Dict[str, Any]:
 		"""Load the wrapper DLL and initialize the ECI engine."""
@@ -193,6 +209,8 @@ class EloquenceClient:
 		self._audio_buf = ctypes.create_string_buffer(self._buf_size)
 		self._out_type = ctypes.c_int(0)
 		self._out_value = ctypes.c_int(0)
+		self._markers = (ELOQ_MARKER * _MAX_BATCH_MARKERS)()
+		self._num_markers = ctypes.c_int(0)
 
 		LOGGER.info("_oldeloq: calling eloq_init(%s)", engine_dir)
 		rc = self._dll.eloq_init(engine_dir)
@@ -250,6 +268,28 @@ class EloquenceClient:
 			ctypes.POINTER(ctypes.c_int),
 		)
 		dll.eloq_read.restype = ctypes.c_int
+		# Blocking read (newer wrapper builds); fall back to polling if absent.
+		self._has_read_wait = hasattr(dll, "eloq_read_wait")
+		if self._has_read_wait:
+			dll.eloq_read_wait.argtypes = (
+				ctypes.c_void_p,
+				ctypes.c_int,
+				ctypes.c_int,
+				ctypes.POINTER(ctypes.c_int),
+				ctypes.POINTER(ctypes.c_int),
+			)
+			dll.eloq_read_wait.restype = ctypes.c_int
+		self._has_read_batch = hasattr(dll, "eloq_read_batch")
+		if self._has_read_batch:
+			dll.eloq_read_batch.argtypes = (
+				ctypes.c_void_p,
+				ctypes.c_int,
+				ctypes.POINTER(ELOQ_MARKER),
+				ctypes.c_int,
+				ctypes.POINTER(ctypes.c_int),
+				ctypes.c_int,
+			)
+			dll.eloq_read_batch.restype = ctypes.c_int
 		dll.eloq_set_variant.argtypes = (ctypes.c_int,)
 		dll.eloq_set_variant.restype = ctypes.c_int
 		dll.eloq_set_vparam.argtypes = (ctypes.c_int, ctypes.c_int)
@@ -307,17 +347,32 @@ class EloquenceClient:
 		return self._read_loop()
 
 	def _read_loop(self) -> bool:
-		"""Poll eloq_read() and push audio to queue. Returns True if completed normally."""
+		"""Pull from eloq_read_wait() (or poll eloq_read()) and push audio to queue.
+
+		Returns True if completed normally.
+		"""
+		if self._has_read_batch:
+			return self._read_loop_batch()
 		audio_chunks = 0
 		audio_bytes = 0
 		while not self._should_stop:
 			try:
-				n = self._dll.eloq_read(
-					self._audio_buf,
-					self._buf_size,
-					ctypes.byref(self._out_type),
-					ctypes.byref(self._out_value),
-				)
+				if self._has_read_wait:
+					# Wakes on data, DONE or eloq_stop; timeout only bounds _should_stop checks.
+					n = self._dll.eloq_read_wait(
+						self._audio_buf,
+						self._buf_size,
+						100,
+						ctypes.byref(self._out_type),
+						ctypes.byref(self._out_value),
+					)
+				else:
+					n = self._dll.eloq_read(
+						self._audio_buf,
+						self._buf_size,
+						ctypes.byref(self._out_type),
+						ctypes.byref(self._out_value),
+					)
 			except Exception:
 				LOGGER.exception("eloq_read crashed")
 				self._audio_queue.put((b"", None, True, self._current_seq))
@@ -340,11 +395,50 @@ class EloquenceClient:
 				LOGGER.error("Wrapper error %d", self._out_value.value)
 				self._audio_queue.put((b"", None, True, self._current_seq))
 				return False
-			elif t == ELOQ_ITEM_NONE:
+			elif t == ELOQ_ITEM_NONE and not self._has_read_wait:
 				time.sleep(0.001)
 		LOGGER.debug("read_loop stopped: %d chunks, %d bytes", audio_chunks, audio_bytes)
 		return False
 
+	def _read_loop_batch(self) -> bool:
+		"""Drain audio plus markers with eloq_read_batch, one call per buffer-full."""
+		audio_chunks = 0
+		audio_bytes = 0
+		while not self._should_stop:
+			try:
+				n = self._dll.eloq_read_batch(
+					self._audio_buf,
+					self._buf_size,
+					self._markers,
+					_MAX_BATCH_MARKERS,
+					ctypes.byref(self._num_markers),
+					100,
+				)
+			except Exception:
+				LOGGER.exception("eloq_read_batch crashed")
+				self._audio_queue.put((b"", None, True, self._current_seq))
+				return False
+
+			if n > 0:
+				audio_chunks += 1
+				audio_bytes += n
+				self._audio_queue.put((bytes(self._audio_buf.raw[:n]), None, False, self._current_seq))
+
+			# DONE/ERROR always end a batch, so all audio before them is queued above.
+			for i in range(self._num_markers.value):
+				m = self._markers[i]
+				if m.type == ELOQ_ITEM_DONE:
+					LOGGER.debug("read_loop DONE: %d chunks, %d bytes", audio_chunks, audio_bytes)
+					self._audio_queue.put((b"", None, True, self._current_seq))
+					return True
+				if m.type == ELOQ_ITEM_ERROR:
+					LOGGER.error("Wrapper error %d", m.value)
+					self._audio_queue.put((b"", None, True, self._current_seq))
+					return False
+				# INDEX from engine — ignored (we use feed_marker instead)
+		LOGGER.debug("read_loop stopped: %d chunks, %d bytes", audio_chunks, audio_bytes)
+		return False
+
 	# ------------------------------------------------------------------
 	# Control
 	def dll_call(self, func_name: str, *args):
@@ -0,0 +1,433 @@
+// eloq_bench.cpp
+//
+// Benchmark harness for the wrapper DLL.
+// - engine: drives eloq_speak/eloq_read_batch over a text corpus and reports
+//   time to first audio, real-time factor, CPU per second of audio and stop
+//   latency for each engine directory and rate-boost value.
+// - stages: runs the engine-free pipeline (trimming, sonic, queue push/pop, gain)
+//   on synthetic PCM via eloq_bench_stages, so no ECI DLLs are needed.
+//
+// Usage:
+//   eloq_bench engine <eciDir> [<eciDir> ...] [--corpus file] [--boost 100,150,200]
+//                     [--runs n] [--dll path]
+//   eloq_bench stages [--boost 100,150,200,300] [--seconds n] [--rate hz]
+//                     [--buffer bytes] [--dll path]
+//
+// Build as 32-bit, like the wrapper.
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// ------------------------------------------------------------
+// Wrapper ABI (mirrors eloquence_wrapper.cpp)
+// ------------------------------------------------------------
+#define ELOQ_ITEM_DONE  3
+#define ELOQ_ITEM_ERROR 4
+#define ELOQ_HIST_BUCKETS 10
+
+struct ELOQ_MARKER {
+    int type;
+    int value;
+    int byteOffset;
+};
+
+struct ELOQ_LATENCY {
+    unsigned int count;
+    unsigned int lastUs;
+    unsigned int maxUs;
+    unsigned int avgUs;
+    unsigned int hist[ELOQ_HIST_BUCKETS];
+};
+
+struct ELOQ_STATS {
+    ELOQ_LATENCY firstAudio;
+    ELOQ_LATENCY stop;
+    unsigned int utterances;
+    unsigned int rtfLastPermille;
+    unsigned int rtfAvgPermille;
+    unsigned int sonicBuffers;
+    unsigned int sonicAvgUs;
+    unsigned int sonicMaxUs;
+    unsigned int queuedBytesPeak;
+    unsigned int queuedBytesCap;
+    unsigned int markersPeak;
+    unsigned int droppedBuffers;
+    unsigned int droppedMarkers;
+    unsigned long long droppedBytes;
+    unsigned long long overrunBytes;
+    unsigned long long trimmedBytes;
+    unsigned long long synthUs;
+    unsigned long long audioUs;
+};
+
+struct ELOQ_STAGE_BENCH {
+    int sampleRate;
+    int bufferBytes;
+    int audioMs;
+    int rateBoostPct;
+    unsigned long long inBytes;
+    unsigned long long trimmedBytes;
+    unsigned long long outBytes;
+    unsigned int trimUs;
+    unsigned int sonicUs;
+    unsigned int pushUs;
+    unsigned int popUs;
+    int gainPct;
+    unsigned int gainUs;
+};
+
+typedef int  (__cdecl* InitFn)(const wchar_t*);
+typedef void (__cdecl* FreeFn)(void);
+typedef int  (__cdecl* FormatFn)(int*, int*, int*);
+typedef int  (__cdecl* SpeakFn)(const char*);
+typedef int  (__cdecl* StopFn)(void);
+typedef int  (__cdecl* ReadBatchFn)(void*, int, ELOQ_MARKER*, int, int*, int);
+typedef int  (__cdecl* SetIntFn)(int);
+typedef int  (__cdecl* GetStatsFn)(ELOQ_STATS*);
+typedef int  (__cdecl* BenchStagesFn)(ELOQ_STAGE_BENCH*);
+
+struct Api {
+    HMODULE dll = nullptr;
+    InitFn init = nullptr;
+    FreeFn release = nullptr;
+    FormatFn format = nullptr;
+    SpeakFn speak = nullptr;
+    StopFn stop = nullptr;
+    ReadBatchFn readBatch = nullptr;
+    SetIntFn setRateBoost = nullptr;
+    SetIntFn setCacheSize = nullptr;
+    GetStatsFn getStats = nullptr;
+    BenchStagesFn benchStages = nullptr;
+};
+
+template <typename T>
+static bool bind(HMODULE m, const char* name, T& fn) {
+    fn = reinterpret_cast<T>(GetProcAddress(m, name));
+    if (!fn) fprintf(stderr, "eloq_bench: missing export %s\n", name);
+    return fn != nullptr;
+}
+
+static bool loadApi(const std::wstring& path, Api& api) {
+    api.dll = LoadLibraryW(path.c_str());
+    if (!api.dll) {
+        fprintf(stderr, "eloq_bench: cannot load %ls (err=%lu)\n", path.c_str(), GetLastError());
+        return false;
+    }
+    bool ok = true;
+    ok &= bind(api.dll, "eloq_init", api.init);
+    ok &= bind(api.dll, "eloq_free", api.release);
+    ok &= bind(api.dll, "eloq_format", api.format);
+    ok &= bind(api.dll, "eloq_speak", api.speak);
+    ok &= bind(api.dll, "eloq_stop", api.stop);
+    ok &= bind(api.dll, "eloq_read_batch", api.readBatch);
+    ok &= bind(api.dll, "eloq_set_rate_boost", api.setRateBoost);
+    ok &= bind(api.dll, "eloq_set_cache_size", api.setCacheSize);
+    ok &= bind(api.dll, "eloq_get_stats", api.getStats);
+    ok &= bind(api.dll, "eloq_bench_stages", api.benchStages);
+    return ok;
+}
+
+// ------------------------------------------------------------
+// Measurement helpers
+// ------------------------------------------------------------
+static double nowMs() {
+    static LARGE_INTEGER freq = {};
+    if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    LARGE_INTEGER t;
+    QueryPerformanceCounter(&t);
+    return (double)t.QuadPart * 1000.0 / (double)freq.QuadPart;
+}
+
+static double cpuMs() {
+    FILETIME c, e, k, u;
+    if (!GetProcessTimes(GetCurrentProcess(), &c, &e, &k, &u)) return 0;
+    const uint64_t kt = ((uint64_t)k.dwHighDateTime << 32) | k.dwLowDateTime;
+    const uint64_t ut = ((uint64_t)u.dwHighDateTime << 32) | u.dwLowDateTime;
+    return (double)(kt + ut) / 10000.0;
+}
+
+struct Series {
+    std::vector<double> v;
+    void add(double x) { v.push_back(x); }
+    double avg() const {
+        if (v.empty()) return 0;
+        double t = 0;
+        for (double x : v) t += x;
+        return t / v.size();
+    }
+    double pct(double p) const {
+        if (v.empty()) return 0;
+        std::vector<double> s(v);
+        std::sort(s.begin(), s.end());
+        size_t i = (size_t)(p * (s.size() - 1) + 0.5);
+        return s[std::min(i, s.size() - 1)];
+    }
+};
+
+static const char* const kDefaultCorpus[] = {
+    "Hello.",
+    "The quick brown fox jumps over the lazy dog.",
+    "Press the Insert key together with the down arrow to start reading continuously from the cursor.",
+    "Link. Heading level 2. Button. Edit, has auto complete, blank.",
+    "In the beginning the Universe was created. This has made a lot of people very angry "
+    "and been widely regarded as a bad move. Many races believe that it was created by "
+    "some sort of god, though the Jatravartid people of Viltvodle Six believe that the entire "
+    "Universe was in fact sneezed out of the nose of a being called the Great Green Arkleseizure.",
+};
+
+static std::vector<std::string> loadCorpus(const std::wstring& path) {
+    std::vector<std::string> out;
+    if (path.empty()) {
+        for (const char* t : kDefaultCorpus) out.push_back(t);
+        return out;
+    }
+    FILE* f = _wfopen(path.c_str(), L"rb");
+    if (!f) {
+        fprintf(stderr, "eloq_bench: cannot open corpus %ls\n", path.c_str());
+        return out;
+    }
+    char line[8192];
+    while (fgets(line, sizeof(line), f)) {
+        size_t n = strlen(line);
+        while (n && (line[n - 1] == '\n' || line[n - 1] == '\r')) line[--n] = 0;
+        if (n) out.push_back(line);
+    }
+    fclose(f);
+    return out;
+}
+
+static std::vector<int> parseList(const wchar_t* s) {
+    std::vector<int> out;
+    while (*s) {
+        wchar_t* end = nullptr;
+        long v = wcstol(s, &end, 10);
+        if (end == s) break;
+        out.push_back((int)v);
+        s = end;
+        if (*s == L',') s++;
+    }
+    return out;
+}
+
+// ------------------------------------------------------------
+// Engine mode
+// ------------------------------------------------------------
+struct UtteranceResult {
+    double ttfaMs = -1;
+    double totalMs = 0;
+    double cpuMs = 0;
+    uint64_t bytes = 0;
+    bool ok = false;
+};
+
+// Speaks one text and reads it to DONE.
+static UtteranceResult runUtterance(const Api& api, const char* text) {
+    static std::vector<uint8_t> buf(64 * 1024);
+    ELOQ_MARKER marks[64];
+    UtteranceResult r;
+    const double c0 = cpuMs();
+    const double t0 = nowMs();
+    api.speak(text);
+    for (;;) {
+        int numMarks = 0;
+        const int n = api.readBatch(buf.data(), (int)buf.size(), marks, 64, &numMarks, 30000);
+        if (n == 0 && numMarks == 0) break; // timeout
+        if (n > 0) {
+            if (r.ttfaMs < 0) r.ttfaMs = nowMs() - t0;
+            r.bytes += (uint64_t)n;
+        }
+        if (numMarks > 0 && (marks[numMarks - 1].type == ELOQ_ITEM_DONE ||
+                             marks[numMarks - 1].type == ELOQ_ITEM_ERROR)) {
+            r.ok = marks[numMarks - 1].type == ELOQ_ITEM_DONE;
+            break;
+        }
+    }
+    r.totalMs = nowMs() - t0;
+    r.cpuMs = cpuMs() - c0;
+    return r;
+}
+
+// Starts the longest corpus text, stops it once audio flows and returns the
+// worker-measured stop-to-quiet latency in microseconds (-1 if not seen).
+static double runStop(const Api& api, const char* text) {
+    static std::vector<uint8_t> buf(64 * 1024);
+    ELOQ_MARKER marks[64];
+    ELOQ_STATS before = {};
+    api.getStats(&before);
+    api.speak(text);
+    int numMarks = 0;
+    if (api.readBatch(buf.data(), (int)buf.size(), marks, 64, &numMarks, 5000) <= 0) return -1;
+    Sleep(50);
+    api.stop();
+    for (int i = 0; i < 200; i++) {
+        ELOQ_STATS after = {};
+        api.getStats(&after);
+        if (after.stop.count != before.stop.count) return (double)after.stop.lastUs;
+        Sleep(5);
+    }
+    return -1;
+}
+
+static int runEngine(const Api& api, const std::vector<std::wstring>& dirs,
+                     const std::vector<std::string>& corpus, const std::vector<int>& boosts, int runs) {
+    if (corpus.empty()) return 1;
+    size_t longest = 0;
+    for (size_t i = 1; i < corpus.size(); i++)
+        if (corpus[i].size() > corpus[longest].size()) longest = i;
+
+    printf("%-28s %6s %9s %9s %7s %7s %9s %9s %9s\n",
+        "engine", "boost", "ttfa_avg", "ttfa_p95", "rtf", "rtf_eng", "cpu/s", "stop_avg", "stop_max");
+    for (const std::wstring& dir : dirs) {
+        const double i0 = nowMs();
+        const int rc = api.init(dir.c_str());
+        if (rc != 0) {
+            fprintf(stderr, "eloq_bench: eloq_init(%ls) failed (%d)\n", dir.c_str(), rc);
+            continue;
+        }
+        int rate = 0, bits = 0, ch = 0;
+        api.format(&rate, &bits, &ch);
+        const double bytesPerMs = rate * (bits / 8) * ch / 1000.0;
+        fprintf(stderr, "%ls: init %.1f ms, %d Hz %d-bit %d ch\n", dir.c_str(), nowMs() - i0, rate, bits, ch);
+        // Measure the engine, not replays.
+        api.setCacheSize(0);
+
+        char label[29];
+        snprintf(label, sizeof(label), "%ls", dir.c_str());
+        for (int boost : boosts) {
+            api.setRateBoost(boost);
+            runUtterance(api, corpus[0].c_str()); // warm-up, applies the boost
+
+            // Engine RTF over this row only; the stats are cumulative.
+            ELOQ_STATS st0 = {};
+            api.getStats(&st0);
+            Series ttfa, stop;
+            double totalMs = 0, cpu = 0, audioMs = 0;
+            int failed = 0;
+            for (int k = 0; k < runs; k++) {
+                for (const std::string& text : corpus) {
+                    UtteranceResult r = runUtterance(api, text.c_str());
+                    if (!r.ok) { failed++; continue; }
+                    if (r.ttfaMs >= 0) ttfa.add(r.ttfaMs);
+                    totalMs += r.totalMs;
+                    cpu += r.cpuMs;
+                    audioMs += bytesPerMs > 0 ? r.bytes / bytesPerMs : 0;
+                }
+                const double us = runStop(api, corpus[longest].c_str());
+                if (us >= 0) stop.add(us / 1000.0);
+            }
+            ELOQ_STATS st = {};
+            api.getStats(&st);
+            const unsigned long long engAudioUs = st.audioUs - st0.audioUs;
+            printf("%-28s %5d%% %7.1fms %7.1fms %7.3f %7.3f %7.1fms %7.2fms %7.2fms\n",
+                label, boost, ttfa.avg(), ttfa.pct(0.95),
+                audioMs > 0 ? totalMs / audioMs : 0.0,
+                engAudioUs ? (double)(st.synthUs - st0.synthUs) / engAudioUs : 0.0,
+                audioMs > 0 ? cpu * 1000.0 / audioMs : 0.0,
+                stop.avg(), stop.pct(1.0));
+            if (failed) fprintf(stderr, "  %d utterances did not complete\n", failed);
+        }
+        api.setRateBoost(100);
+        api.release();
+    }
+    return 0;
+}
+
+// ------------------------------------------------------------
+// Stages mode
+// ------------------------------------------------------------
+static int runStages(const Api& api, const std::vector<int>& boosts, int seconds, int rate, int bufferBytes) {
+    printf("%6s %10s %10s %10s %10s %10s %10s %9s %9s\n",
+        "boost", "trim", "sonic", "push", "pop", "gain", "total", "trimmed", "out/in");
+    for (int boost : boosts) {
+        ELOQ_STAGE_BENCH b = {};
+        b.sampleRate = rate;
+        b.bufferBytes = bufferBytes;
+        b.audioMs = seconds * 1000;
+        b.rateBoostPct = boost;
+        if (api.benchStages(&b) != 0) {
+            fprintf(stderr, "eloq_bench: eloq_bench_stages failed\n");
+            return 1;
+        }
+        // Normalize to microseconds per second of input audio.
+        const double perSec = 1.0 / seconds;
+        const unsigned total = b.trimUs + b.sonicUs + b.pushUs + b.popUs + b.gainUs;
+        printf("%5d%% %8.1fus %8.1fus %8.1fus %8.1fus %8.1fus %8.1fus %8.1f%% %9.3f\n",
+            boost, b.trimUs * perSec, b.sonicUs * perSec, b.pushUs * perSec, b.popUs * perSec,
+            b.gainUs * perSec, total * perSec,
+            b.inBytes ? 100.0 * b.trimmedBytes / b.inBytes : 0.0,
+            b.inBytes ? (double)b.outBytes / b.inBytes : 0.0);
+    }
+    printf("(times are per second of input audio)\n");
+    return 0;
+}
+
+// ------------------------------------------------------------
+// Entry
+// ------------------------------------------------------------
+static void usage() {
+    fprintf(stderr,
+        "usage:\n"
+        "  eloq_bench engine <eciDir> [<eciDir> ...] [--corpus file] [--boost 100,150,200]\n"
+        "                    [--runs n] [--dll path]\n"
+        "  eloq_bench stages [--boost 100,150,200,300] [--seconds n] [--rate hz]\n"
+        "                    [--buffer bytes] [--dll path]\n");
+}
+
+static std::wstring defaultDllPath() {
+    wchar_t path[MAX_PATH];
+    DWORD n = GetModuleFileNameW(nullptr, path, MAX_PATH);
+    std::wstring p(path, n);
+    const size_t slash = p.find_last_of(L"\\/");
+    p = (slash == std::wstring::npos) ? std::wstring() : p.substr(0, slash + 1);
+    return p + L"eloquence_wrapper.dll";
+}
+
+int wmain(int argc, wchar_t** argv) {
+    if (argc < 2) {
+        usage();
+        return 2;
+    }
+    const std::wstring mode = argv[1];
+    std::vector<std::wstring> dirs;
+    std::wstring corpusPath;
+    std::wstring dllPath = defaultDllPath();
+    std::vector<int> boosts;
+    int runs = 3, seconds = 60, rate = 11025, bufferBytes = 4096;
+
+    for (int i = 2; i < argc; i++) {
+        const std::wstring a = argv[i];
+        const bool hasVal = i + 1 < argc;
+        if (a == L"--corpus" && hasVal) corpusPath = argv[++i];
+        else if (a == L"--dll" && hasVal) dllPath = argv[++i];
+        else if (a == L"--boost" && hasVal) boosts = parseList(argv[++i]);
+        else if (a == L"--runs" && hasVal) runs = std::max(1, _wtoi(argv[++i]));
+        else if (a == L"--seconds" && hasVal) seconds = std::max(1, _wtoi(argv[++i]));
+        else if (a == L"--rate" && hasVal) rate = _wtoi(argv[++i]);
+        else if (a == L"--buffer" && hasVal) bufferBytes = _wtoi(argv[++i]);
+        else if (a.compare(0, 2, L"--") == 0) { usage(); return 2; }
+        else dirs.push_back(a);
+    }
+
+    Api api;
+    if (!loadApi(dllPath, api)) return 1;
+
+    if (mode == L"engine") {
+        if (dirs.empty()) { usage(); return 2; }
+        if (boosts.empty()) boosts = { 100, 150, 200 };
+        return runEngine(api, dirs, loadCorpus(corpusPath), boosts, runs);
+    }
+    if (mode == L"stages") {
+        if (boosts.empty()) boosts = { 100, 150, 200, 300 };
+        return runStages(api, boosts, seconds, rate, bufferBytes);
+    }
+    usage();
+    return 2;
+}
@@ -22,6 +22,142 @@
 #define ELOQ_ITEM_DONE  3
 #define ELOQ_ITEM_ERROR 4
 
+// Setting ids for eloq_set_params (1-7 are the ECI voice params).
+#define ELOQ_PARAM_VARIANT    100
+#define ELOQ_PARAM_VOICE      101 // 3.3 language id
+#define ELOQ_PARAM_RATE_BOOST 102 // percent, 100-600
+#define ELOQ_PARAM_INLINE     103 // 3.3: 0/1, batch param changes as annotations
+#define ELOQ_PARAM_GAIN       104 // output gain in percent, 0-400, live
+
+// eloq_speak_ex priorities and flags. Urgent text interrupts the normal
+// lane; the interrupted speech resumes after it from its last chunk
+// boundary, reusing the audio already rendered. Urgent items play in
+// arrival order, and each one ends with a DONE whose value is
+// ELOQ_DONE_URGENT.
+#define ELOQ_PRIORITY_NORMAL 0
+#define ELOQ_PRIORITY_URGENT 1
+#define ELOQ_SPEAK_QUEUE     0x1 // normal lane: follow current speech (eloq_queue)
+#define ELOQ_DONE_URGENT     1
+
+// eloq_ready_warm results besides eloq_ready's 0/-1/-3. WARM: the warm-up
+// phrase has run, so the first utterance starts at steady-state latency.
+// COLD: the engine is up, but warm-up is off or gave way to an early command.
+#define ELOQ_READY_WARM 1
+#define ELOQ_READY_COLD 2
+
+// Marker record filled by eloq_read_batch. byteOffset is the position in the
+// caller's audio buffer the marker follows (== returned byte count when the
+// marker comes after all audio in the batch).
+struct ELOQ_MARKER {
+    int type;
+    int value;
+    int byteOffset;
+};
+
+// Marker record filled by eloq_read_batch_ex: ELOQ_MARKER plus the marker's
+// sample offset, counted in output frames from the first sample of its
+// utterance. With rate boost or resampling the offset is in the stretched
+// output stream, so it lines up with the audio actually played.
+struct ELOQ_MARKER_EX {
+    int type;
+    int value;
+    int byteOffset;
+    unsigned int sampleOffset;
+};
+
+// Offline rendering (eloq_render). The sink callback receives raw PCM in the
+// engine's output format as it is produced; returning nonzero aborts the
+// render. Stats are filled on return, including after an abort.
+typedef int (__cdecl* ELOQ_RENDER_CB)(void* user, const void* pcm, int bytes);
+
+struct ELOQ_RENDER_STATS {
+    int sampleRate;
+    int bitsPerSample;
+    int channels;
+    unsigned int audioBytes; // PCM bytes delivered (excluding the WAV header)
+    int audioMs;             // duration of the rendered audio
+    int firstAudioMs;        // render start to first PCM (-1 if none)
+    int elapsedMs;           // render start to completion (-1 if never started)
+    int indexCount;          // index markers passed during the render
+};
+
+// Runtime statistics (eloq_get_stats). Counters are cumulative since init;
+// latencies are microseconds with a histogram over kLatencyEdgesMs.
+#define ELOQ_HIST_BUCKETS 10 // <1 <2 <5 <10 <20 <50 <100 <200 <500 >=500 ms
+
+struct ELOQ_LATENCY {
+    unsigned int count;
+    unsigned int lastUs;
+    unsigned int maxUs;
+    unsigned int avgUs;
+    unsigned int hist[ELOQ_HIST_BUCKETS];
+};
+
+struct ELOQ_STATS {
+    ELOQ_LATENCY firstAudio;       // eloq_speak to first audio in the output queue
+    ELOQ_LATENCY stop;             // eloq_stop/eloq_speak to a quiet engine
+    unsigned int utterances;       // synthesized to completion (cache hits excluded)
+    unsigned int rtfLastPermille;  // synthesis time / audio duration, x1000
+    unsigned int rtfAvgPermille;
+    unsigned int sonicBuffers;     // buffers time-stretched by the rate boost
+    unsigned int sonicAvgUs;
+    unsigned int sonicMaxUs;
+    unsigned int queuedBytesPeak;  // most audio waiting in the output queue
+    unsigned int queuedBytesCap;   // output queue capacity
+    unsigned int markersPeak;      // most markers waiting in the output queue
+    unsigned int droppedBuffers;   // audio buffers discarded as stale (canceled generation)
+    unsigned int droppedMarkers;
+    unsigned long long droppedBytes;
+    unsigned long long overrunBytes; // oldest audio overwritten because the queue was full
+    unsigned long long trimmedBytes; // silence removed by the trimmer
+    unsigned long long synthUs;      // totals behind rtfAvgPermille, for deltas
+    unsigned long long audioUs;
+};
+
+// Dictionary manager (eloq_get_dict_stats). Entry counts are for the
+// dictionary currently in use.
+struct ELOQ_DICT_STATS {
+    int result;                // last eloq_load_dict: 0 ok, 1 swap pending, <0 failed
+    unsigned int loads;        // dictionaries swapped in since init
+    unsigned int mainEntries;
+    unsigned int rootEntries;
+    unsigned int skippedLines; // source lines without a key and translation
+    unsigned int rejected;     // entries the engine refused
+    unsigned int cacheHits;    // volumes served from an up-to-date binary cache
+    unsigned int parseUs;      // caller: cache check or rebuild
+    unsigned int loadUs;       // worker: new dictionary built and swapped in
+};
+
+// Engine-free pipeline benchmark (eloq_bench_stages): synthetic 16-bit mono
+// PCM is pushed through the trimmer, sonic and the output queue and read
+// back, timing each stage.
+struct ELOQ_STAGE_BENCH {
+    int sampleRate;    // in: synthetic format
+    int bufferBytes;   // in: bytes per engine buffer
+    int audioMs;       // in: amount of input audio
+    int rateBoostPct;  // in: 100 = sonic off
+    unsigned long long inBytes;      // out
+    unsigned long long trimmedBytes; // out: removed by the trimmer
+    unsigned long long outBytes;     // out: read back from the queue
+    unsigned int trimUs;             // out: total time per stage
+    unsigned int sonicUs;
+    unsigned int pushUs;
+    unsigned int popUs;
+    int gainPct;       // in: output gain, 0 = 150 (limiter engaged)
+    unsigned int gainUs;             // out: gain stage, not counted in popUs
+};
+
+// Mock engine (eloq_init(L"mock:33") or L"mock:20"): an in-process stand-in
+// for ECI32D.DLL, for load tests without the engine binaries. Settings apply
+// to engines created after eloq_set_mock_config.
+struct ELOQ_MOCK_CONFIG {
+    int msPerChar;     // audio per letter at normal speed (default 60)
+    int rtfPermille;   // synthesis time per audio time x1000, 0 = unpaced (default 100)
+    int sampleRate;    // 2.0 style output rate (default 11025; 3.3 style is fixed at 11025)
+    int bitsPerSample; // 2.0 style: 8 or 16 (default 16)
+    int bufferSamples; // 2.0 style samples per waveOut buffer (default 2048)
+};
+
 // Modes.
 #define ELOQ_MODE_NONE 0
 #define ELOQ_MODE_33   33
@@ -29,16 +165,32 @@
 
 #include <windows.h>
 #include <mmsystem.h>
+#include <mmreg.h>
 #include <intrin.h>
 
+#if defined(_M_IX86) || defined(_M_X64)
+#include <emmintrin.h>
+#define ELOQ_HAVE_SSE2 1
+#else
+#define ELOQ_HAVE_SSE2 0
+#endif
+
+#include <algorithm>
 #include <atomic>
+#include <bitset>
+#include <climits>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <deque>
+#include <list>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 #include "MinHook.h"
@@ -49,10 +201,247 @@
 #pragma comment(lib, "user32.lib")
 
 // ------------------------------------------------------------
-// Debug tracing (writes to eloq_debug.log next to the DLL)
+// Debug tracing (written to eloq_debug.log next to the DLL)
 // ------------------------------------------------------------
+// Producers never lock or touch the file. Each thread owns a fixed ring of
+// binary records (format pointer + raw args + copied string bytes); records
+// are formatted and written by a background flusher (started by eloq_init)
+// or on demand by eloq_dump_trace. A full ring drops new records.
+//
+// Levels are filtered twice: at compile time (ELOQ_LOG_COMPILE_LEVEL) so
+// dbg() calls above it vanish, and at run time (eloq_set_log_level) with a
+// single relaxed load before any argument is touched.
+#define ELOQ_LOG_OFF   0
+#define ELOQ_LOG_ERROR 1
+#define ELOQ_LOG_INFO  2
+#define ELOQ_LOG_DEBUG 3
+
+#ifndef ELOQ_LOG_COMPILE_LEVEL
+#define ELOQ_LOG_COMPILE_LEVEL ELOQ_LOG_DEBUG
+#endif
+
+static std::atomic<int> g_logLevel{ ELOQ_LOG_INFO };
+
+#define dbgAt(level, ...)                                                        \
+    do {                                                                         \
+        if ((level) <= ELOQ_LOG_COMPILE_LEVEL &&                                 \
+            (level) <= g_logLevel.load(std::memory_order_relaxed))               \
+            traceEmit((level), __VA_ARGS__);                                     \
+    } while (0)
+#define dbg(...)      dbgAt(ELOQ_LOG_DEBUG, __VA_ARGS__)
+#define dbgInfo(...)  dbgAt(ELOQ_LOG_INFO, __VA_ARGS__)
+#define dbgError(...) dbgAt(ELOQ_LOG_ERROR, __VA_ARGS__)
+
+static const int kTraceMaxArgs = 8;
+static const int kTraceStrBytes = 96;
+static const uint32_t kTraceRingSize = 256; // records per thread (power of 2)
+static const uint16_t kTraceNoStr = 0xFFFF;
+
+union TraceArg {
+    long long i;
+    double d;
+    const void* p;
+};
+
+struct TraceRecord {
+    const char* fmt;
+    uint32_t seq;   // global order across threads
+    DWORD tick;
+    DWORD tid;
+    uint8_t level;
+    uint8_t nargs;
+    uint16_t strUsed;
+    TraceArg args[kTraceMaxArgs];
+    uint16_t strOff[kTraceMaxArgs]; // offset into str for string args
+    char str[kTraceStrBytes];
+};
+
+// Single producer (owning thread), single consumer (flusher, under g_logMtx).
+struct TraceRing {
+    std::atomic<uint32_t> writeIdx{ 0 };
+    std::atomic<uint32_t> readIdx{ 0 };
+    std::atomic<uint32_t> dropped{ 0 };
+    std::atomic<bool> owned{ true }; // false once the owning thread exits
+    DWORD tid = 0;
+    TraceRing* next = nullptr;
+    TraceRecord recs[kTraceRingSize];
+};
+
+static std::atomic<TraceRing*> g_traceRings{ nullptr };
+static std::atomic<uint32_t> g_traceSeq{ 0 };
+static thread_local TraceRing* t_traceRing = nullptr;
+
+// Hands the thread's ring back on thread exit (the CRT runs thread_local
+// destructors from DLL_THREAD_DETACH); records still in it are flushed as
+// usual and the next new thread picks it up.
+struct TraceRingRelease {
+    ~TraceRingRelease() {
+        if (t_traceRing) t_traceRing->owned.store(false, std::memory_order_release);
+        t_traceRing = nullptr;
+    }
+};
+static thread_local TraceRingRelease t_traceRingRelease;
+
 static FILE* g_logFile = nullptr;
-static std::mutex g_logMtx;
+static std::mutex g_logMtx; // consumer side only
+
+// Rings are never freed, so the registry is a push-only lock-free list; a
+// thread first claims a ring left by an exited thread, so the list only
+// grows to the peak number of tracing threads.
+static TraceRing* traceThreadRing() {
+    TraceRing* r = t_traceRing;
+    if (r) return r;
+    (void)&t_traceRingRelease; // odr-use: registers the exit hook
+    for (r = g_traceRings.load(std::memory_order_acquire); r; r = r->next) {
+        bool expected = false;
+        if (!r->owned.load(std::memory_order_relaxed)) {
+            if (r->owned.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                r->tid = GetCurrentThreadId();
+                t_traceRing = r;
+                return r;
+            }
+        }
+    }
+    r = new TraceRing();
+    r->tid = GetCurrentThreadId();
+    TraceRing* head = g_traceRings.load(std::memory_order_relaxed);
+    do {
+        r->next = head;
+    } while (!g_traceRings.compare_exchange_weak(head, r,
+        std::memory_order_release, std::memory_order_relaxed));
+    t_traceRing = r;
+    return r;
+}
+
+static void traceCopyStr(TraceRecord& rec, int idx, const char* sz) {
+    rec.args[idx].p = sz;
+    if (!sz) return;
+    size_t room = (size_t)kTraceStrBytes - rec.strUsed;
+    if (room < 2) return;
+    size_t n = strnlen(sz, room - 1);
+    memcpy(rec.str + rec.strUsed, sz, n);
+    rec.str[rec.strUsed + n] = '\0';
+    rec.strOff[idx] = rec.strUsed;
+    rec.strUsed = (uint16_t)(rec.strUsed + n + 1);
+}
+
+static void traceCopyStr(TraceRecord& rec, int idx, const wchar_t* wsz) {
+    rec.args[idx].p = wsz;
+    if (!wsz) return;
+    size_t room = (size_t)kTraceStrBytes - rec.strUsed;
+    if (room < 2) return;
+    // Narrowed lossy (non-ASCII becomes '?'); paths are only for diagnostics.
+    size_t n = 0;
+    for (; n + 1 < room && wsz[n]; n++)
+        rec.str[rec.strUsed + n] = (wsz[n] < 0x80) ? (char)wsz[n] : '?';
+    rec.str[rec.strUsed + n] = '\0';
+    rec.strOff[idx] = rec.strUsed;
+    rec.strUsed = (uint16_t)(rec.strUsed + n + 1);
+}
+
+template <typename T>
+static void traceArg(TraceRecord& rec, int idx, T v) {
+    typedef typename std::decay<T>::type U;
+    if constexpr (std::is_floating_point<U>::value) {
+        rec.args[idx].d = (double)v;
+    } else if constexpr (std::is_integral<U>::value || std::is_enum<U>::value) {
+        rec.args[idx].i = (long long)v;
+    } else if constexpr (std::is_same<U, const char*>::value || std::is_same<U, char*>::value) {
+        traceCopyStr(rec, idx, (const char*)v);
+    } else if constexpr (std::is_same<U, const wchar_t*>::value || std::is_same<U, wchar_t*>::value) {
+        traceCopyStr(rec, idx, (const wchar_t*)v);
+    } else {
+        static_assert(std::is_pointer<U>::value, "unsupported trace argument type");
+        rec.args[idx].p = (const void*)v;
+    }
+}
+
+template <typename... A>
+static void traceEmit(int level, const char* fmt, A... a) {
+    static_assert(sizeof...(A) <= (size_t)kTraceMaxArgs, "too many trace arguments");
+    TraceRing* ring = traceThreadRing();
+    const uint32_t w = ring->writeIdx.load(std::memory_order_relaxed);
+    if (w - ring->readIdx.load(std::memory_order_acquire) >= kTraceRingSize) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    TraceRecord& rec = ring->recs[w & (kTraceRingSize - 1)];
+    rec.fmt = fmt;
+    rec.seq = g_traceSeq.fetch_add(1, std::memory_order_relaxed);
+    rec.tick = GetTickCount();
+    rec.tid = ring->tid;
+    rec.level = (uint8_t)level;
+    rec.nargs = (uint8_t)sizeof...(A);
+    rec.strUsed = 0;
+    for (int i = 0; i < kTraceMaxArgs; i++) rec.strOff[i] = kTraceNoStr;
+    int idx = 0;
+    (void)idx;
+    (traceArg(rec, idx++, a), ...);
+    ring->writeIdx.store(w + 1, std::memory_order_release);
+}
+
+// Renders one record through the printf subset used by dbg() callers.
+// Each conversion is re-issued to snprintf on its own with the length
+// modifier normalised to the width the argument was stored at.
+static int traceFormat(const TraceRecord& rec, char* out, size_t cap) {
+    int len = snprintf(out, cap, "[%u.%03u] [%u] ",
+        (unsigned)(rec.tick / 1000), (unsigned)(rec.tick % 1000), (unsigned)rec.tid);
+    if (len < 0) return 0;
+    size_t pos = (size_t)len;
+    int argIdx = 0;
+    for (const char* f = rec.fmt; *f && pos + 1 < cap; ) {
+        if (*f != '%') { out[pos++] = *f++; continue; }
+        if (f[1] == '%') { out[pos++] = '%'; f += 2; continue; }
+
+        char spec[32];
+        size_t sl = 0;
+        spec[sl++] = *f++;
+        while (*f && strchr("-+ #0123456789.", *f) && sl < sizeof(spec) - 4) spec[sl++] = *f++;
+        while (*f && strchr("hlLzjtI", *f)) {
+            if (*f == 'I') { while (*f == 'I' || *f == '6' || *f == '4' || *f == '3' || *f == '2') f++; continue; }
+            f++;
+        }
+        const char conv = *f ? *f++ : 's';
+        if (argIdx >= rec.nargs) break;
+        const TraceArg& arg = rec.args[argIdx];
+        const uint16_t soff = rec.strOff[argIdx];
+        argIdx++;
+
+        int n = 0;
+        switch (conv) {
+        case 'd': case 'i':
+            spec[sl++] = 'l'; spec[sl++] = 'l'; spec[sl++] = conv; spec[sl] = '\0';
+            n = snprintf(out + pos, cap - pos, spec, arg.i);
+            break;
+        case 'u': case 'x': case 'X': case 'o':
+            spec[sl++] = 'l'; spec[sl++] = 'l'; spec[sl++] = conv; spec[sl] = '\0';
+            n = snprintf(out + pos, cap - pos, spec, (unsigned long long)arg.i);
+            break;
+        case 'c':
+            spec[sl++] = 'c'; spec[sl] = '\0';
+            n = snprintf(out + pos, cap - pos, spec, (int)arg.i);
+            break;
+        case 'f': case 'F': case 'g': case 'G': case 'e': case 'E':
+            spec[sl++] = conv; spec[sl] = '\0';
+            n = snprintf(out + pos, cap - pos, spec, arg.d);
+            break;
+        case 's':
+            // %ls strings were narrowed at capture.
+            spec[sl++] = 's'; spec[sl] = '\0';
+            n = snprintf(out + pos, cap - pos, spec,
+                soff != kTraceNoStr ? rec.str + soff : (arg.p ? "(truncated)" : "(null)"));
+            break;
+        default: // 'p' and anything unexpected
+            n = snprintf(out + pos, cap - pos, "%p", arg.p);
+            break;
+        }
+        if (n < 0) break;
+        pos += (size_t)n;
+        if (pos >= cap) pos = cap - 1;
+    }
+    out[pos] = '\0';
+    return (int)pos;
+}
 
 static void dbgOpen() {
     if (g_logFile) return;
@@ -70,18 +459,61 @@ static void dbgOpen() {
     g_logFile = fopen(dllPath, "w");
 }
 
-static void dbg(const char* fmt, ...) {
+// Drains every thread ring, writes records in global order and returns the
+// number written. Only consumers take g_logMtx.
+static int traceFlush() {
     std::lock_guard<std::mutex> lk(g_logMtx);
+    std::vector<TraceRecord> batch;
+    uint32_t dropped = 0;
+    for (TraceRing* r = g_traceRings.load(std::memory_order_acquire); r; r = r->next) {
+        const uint32_t rd = r->readIdx.load(std::memory_order_relaxed);
+        const uint32_t w = r->writeIdx.load(std::memory_order_acquire);
+        for (uint32_t i = rd; i != w; i++)
+            batch.push_back(r->recs[i & (kTraceRingSize - 1)]);
+        r->readIdx.store(w, std::memory_order_release);
+        dropped += r->dropped.exchange(0, std::memory_order_relaxed);
+    }
+    if (batch.empty() && !dropped) return 0;
+
     if (!g_logFile) dbgOpen();
-    if (!g_logFile) return;
-    DWORD ms = GetTickCount();
-    fprintf(g_logFile, "[%u.%03u] ", ms / 1000, ms % 1000);
-    va_list ap;
-    va_start(ap, fmt);
-    vfprintf(g_logFile, fmt, ap);
-    va_end(ap);
-    fprintf(g_logFile, "\n");
+    if (!g_logFile) return 0;
+    std::sort(batch.begin(), batch.end(), [](const TraceRecord& a, const TraceRecord& b) {
+        return (int32_t)(a.seq - b.seq) < 0;
+    });
+    char line[512];
+    for (const TraceRecord& rec : batch) {
+        traceFormat(rec, line, sizeof(line));
+        fputs(line, g_logFile);
+        fputc('\n', g_logFile);
+    }
+    if (dropped) fprintf(g_logFile, "[trace] %u records dropped (ring full)\n", dropped);
     fflush(g_logFile);
+    return (int)batch.size();
+}
+
+// Background flusher: one per process, started by eloq_init, stopped by
+// eloq_free (which drains whatever is left). Both run under g_globalMtx.
+static std::thread g_traceFlusher;
+static HANDLE g_traceStopEvent = nullptr;
+
+static void traceStartFlusher() {
+    if (g_traceFlusher.joinable()) return;
+    if (!g_traceStopEvent) g_traceStopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!g_traceStopEvent) return;
+    ResetEvent(g_traceStopEvent);
+    g_traceFlusher = std::thread([]() {
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+        while (WaitForSingleObject(g_traceStopEvent, 250) == WAIT_TIMEOUT)
+            traceFlush();
+    });
+}
+
+static void traceStopFlusher() {
+    if (g_traceFlusher.joinable()) {
+        SetEvent(g_traceStopEvent);
+        g_traceFlusher.join();
+    }
+    traceFlush();
 }
 
 // ------------------------------------------------------------
@@ -108,6 +540,8 @@ typedef int   (__stdcall* eciVersionFunc)(void* handle);
 typedef int   (__stdcall* eciNewDictFunc)(void* handle);
 typedef int   (__stdcall* eciSetDictFunc)(void* handle, int dict);
 typedef int   (__stdcall* eciLoadDictFunc)(void* handle, int dict, int type, const char* path);
+typedef int   (__stdcall* eciUpdateDictFunc)(void* handle, int dict, int volume, const char* key, const char* translation);
+typedef int   (__stdcall* eciDeleteDictFunc)(void* handle, int dict);
 
 // ECI callback: int __cdecl callback(int handle, int msg, int length, void* data)
 typedef int (__cdecl* EciCallbackFunc)(int, int, int, void*);
@@ -130,26 +564,169 @@ static waveOutResetFunc           g_waveOutResetOrig = nullptr;
 static waveOutCloseFunc           g_waveOutCloseOrig = nullptr;
 
 // ------------------------------------------------------------
-// Stream queue items
+// Output ring: preallocated PCM bytes + side-channel markers
 // ------------------------------------------------------------
-struct StreamItem {
+// Audio lives in a fixed byte ring allocated once at init. INDEX/DONE/ERROR
+// markers live in a separate fixed ring, each tagged with the absolute PCM
+// byte position it follows. Positions are monotonic 64-bit counters, so
+// wrap-around is just a modulo and offsets never need rebasing.
+struct StreamMarker {
     int type = ELOQ_ITEM_NONE;
     int value = 0;
-    uint32_t gen = 0;
+    uint64_t bytePos = 0; // ring writePos at the time the marker was pushed
+    uint32_t frame = 0;   // output frames since the generation's first sample
+};
+
+struct PcmRing {
     std::vector<uint8_t> data;
-    size_t offset = 0;
+    uint64_t readPos = 0;  // total bytes consumed
+    uint64_t writePos = 0; // total bytes produced
+
+    void init(size_t capacity) {
+        data.assign(capacity, 0);
+        readPos = writePos = 0;
+    }
+    size_t capacity() const { return data.size(); }
+    size_t size() const { return (size_t)(writePos - readPos); }
+    size_t space() const { return capacity() - size(); }
+
+    // Raw copies at an absolute position; callers guarantee the span is
+    // within [readPos, readPos + capacity).
+    void copyIn(uint64_t pos, const uint8_t* src, size_t n) {
+        const size_t cap = capacity();
+        const size_t off = (size_t)(pos % cap);
+        const size_t first = (n < cap - off) ? n : (cap - off);
+        std::memcpy(data.data() + off, src, first);
+        if (n > first) std::memcpy(data.data(), src + first, n - first);
+    }
+    void copyOut(uint64_t pos, uint8_t* dst, size_t n) const {
+        const size_t cap = capacity();
+        const size_t off = (size_t)(pos % cap);
+        const size_t first = (n < cap - off) ? n : (cap - off);
+        std::memcpy(dst, data.data() + off, first);
+        if (n > first) std::memcpy(dst + first, data.data(), n - first);
+    }
+};
+
+struct MarkerRing {
+    std::vector<StreamMarker> items;
+    size_t head = 0;
+    size_t count = 0;
 
-    StreamItem() = default;
-    StreamItem(int t, int v, uint32_t g) : type(t), value(v), gen(g), offset(0) {}
+    void init(size_t capacity) {
+        items.assign(capacity ? capacity : 1, StreamMarker());
+        head = count = 0;
+    }
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+    const StreamMarker& front() const { return items[head]; }
+    void pop() {
+        if (!count) return;
+        head = (head + 1) % items.size();
+        count--;
+    }
+    // Drops the oldest marker when full; DONE is always the newest marker
+    // of a generation, so it is never the one lost.
+    void push(const StreamMarker& m) {
+        if (count == items.size()) pop();
+        items[(head + count) % items.size()] = m;
+        count++;
+    }
+    void clear() { head = count = 0; }
+    const StreamMarker& at(size_t i) const { return items[(head + i) % items.size()]; }
 };
 
 // ------------------------------------------------------------
 // Command queue
 // ------------------------------------------------------------
+// Offline render job. Lives on the eloq_render caller's stack; the worker
+// signals doneEvent after its last access.
+struct RenderJob {
+    // Sink: a memory-mapped WAV file, or a callback receiving raw PCM.
+    const wchar_t* outPath = nullptr;
+    ELOQ_RENDER_CB cb = nullptr;
+    void* user = nullptr;
+
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+    uint8_t* view = nullptr;
+    uint64_t mapSize = 0;
+
+    uint64_t dataBytes = 0;
+    int indexCount = 0;
+    DWORD startTick = 0;
+    DWORD firstAudioTick = 0;
+    bool started = false; // worker picked the job up (startTick is valid)
+    bool gotAudio = false;
+    bool aborted = false; // sink failed or callback asked to stop
+    bool ioError = false;
+    int result = 0;
+    HANDLE doneEvent = nullptr;
+};
+
+struct PhraseEntry;
+
 struct Cmd {
     enum Type { CMD_SPEAK, CMD_QUIT } type = CMD_SPEAK;
     uint32_t cancelSnapshot = 0;
     std::string text; // MBCS-encoded
+    RenderJob* render = nullptr; // set: synthesize to the job's sink, not the stream
+    bool queued = false; // eloq_queue: follows the current utterance instead of canceling it
+    bool urgent = false; // eloq_speak_ex urgent lane
+    // Resume of an interrupted generation: its unheard output, replayed
+    // before text (already preprocessed) is synthesized.
+    std::shared_ptr<PhraseEntry> resume;
+};
+
+// ------------------------------------------------------------
+// Phrase cache
+// ------------------------------------------------------------
+// LRU of rendered short utterances. The key is a settings fingerprint
+// followed by the preprocessed text; markers hold byte offsets relative to
+// the start of pcm. Worker-owned.
+struct PhraseEntry {
+    std::string key;
+    std::vector<uint8_t> pcm;
+    std::vector<StreamMarker> markers;
+
+    size_t footprint() const {
+        return sizeof(PhraseEntry) + key.size() + pcm.size() +
+            markers.size() * sizeof(StreamMarker);
+    }
+};
+
+struct PhraseCache {
+    std::list<PhraseEntry> lru; // front = most recently used
+    std::unordered_map<std::string, std::list<PhraseEntry>::iterator> index;
+    size_t bytes = 0;
+
+    const PhraseEntry* find(const std::string& key) {
+        auto it = index.find(key);
+        if (it == index.end()) return nullptr;
+        lru.splice(lru.begin(), lru, it->second);
+        return &lru.front();
+    }
+    void trim(size_t cap) {
+        while (bytes > cap && !lru.empty()) {
+            bytes -= lru.back().footprint();
+            index.erase(lru.back().key);
+            lru.pop_back();
+        }
+    }
+    void insert(PhraseEntry&& e, size_t cap) {
+        if (index.count(e.key)) return;
+        const size_t fp = e.footprint();
+        if (fp > cap) return;
+        trim(cap - fp);
+        lru.push_front(std::move(e));
+        index[lru.front().key] = lru.begin();
+        bytes += fp;
+    }
+    void clear() {
+        index.clear();
+        lru.clear();
+        bytes = 0;
+    }
 };
 
 // ------------------------------------------------------------
@@ -160,6 +737,64 @@ struct SettingInt {
     std::atomic<int> dirty{ 0 };
 };
 
+// ------------------------------------------------------------
+// Statistics
+// ------------------------------------------------------------
+static int64_t qpcFrequency() {
+    LARGE_INTEGER f;
+    QueryPerformanceFrequency(&f);
+    return f.QuadPart;
+}
+
+// Set while the DLL loads (CRT static init), before any thread can call in.
+static const int64_t g_qpcFreq = qpcFrequency();
+
+// Split into whole seconds and remainder so the scale to microseconds
+// cannot overflow (t * 1000000 would after ~10 days at 10 MHz).
+static int64_t nowUs() {
+    LARGE_INTEGER t;
+    QueryPerformanceCounter(&t);
+    const int64_t q = t.QuadPart / g_qpcFreq;
+    const int64_t r = t.QuadPart % g_qpcFreq;
+    return q * 1000000 + r * 1000000 / g_qpcFreq;
+}
+
+static const uint32_t kLatencyEdgesMs[ELOQ_HIST_BUCKETS - 1] = {
+    1, 2, 5, 10, 20, 50, 100, 200, 500
+};
+
+struct LatencyStat {
+    std::atomic<uint32_t> count{ 0 };
+    std::atomic<uint32_t> lastUs{ 0 };
+    std::atomic<uint32_t> maxUs{ 0 };
+    std::atomic<uint64_t> totalUs{ 0 };
+    std::atomic<uint32_t> hist[ELOQ_HIST_BUCKETS] = {};
+
+    // Single writer per stat (the worker or the reader holding outMtx), so
+    // the max needs no compare-exchange.
+    void add(int64_t d) {
+        const uint32_t us = (uint32_t)std::max<int64_t>(0, std::min<int64_t>(d, UINT32_MAX));
+        lastUs.store(us, std::memory_order_relaxed);
+        if (us > maxUs.load(std::memory_order_relaxed)) maxUs.store(us, std::memory_order_relaxed);
+        totalUs.fetch_add(us, std::memory_order_relaxed);
+        int b = 0;
+        while (b < ELOQ_HIST_BUCKETS - 1 && us >= kLatencyEdgesMs[b] * 1000) b++;
+        hist[b].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+    }
+    void read(ELOQ_LATENCY& out) const {
+        out.count = count.load(std::memory_order_relaxed);
+        out.lastUs = lastUs.load(std::memory_order_relaxed);
+        out.maxUs = maxUs.load(std::memory_order_relaxed);
+        out.avgUs = out.count ? (unsigned int)(totalUs.load(std::memory_order_relaxed) / out.count) : 0;
+        for (int i = 0; i < ELOQ_HIST_BUCKETS; i++)
+            out.hist[i] = hist[i].load(std::memory_order_relaxed);
+    }
+};
+
+struct RuleSet; // compiled rules file, see "Text rules"
+struct DictLoad; // see "Dictionary manager"
+
 // ------------------------------------------------------------
 // Global wrapper state
 // ------------------------------------------------------------
@@ -178,6 +813,7 @@ struct ELOQ_STATE {
 
     // DLL directory (for CFG patching, dict loading)
     std::wstring dllDir;
+    bool mock = false; // dllDir "mock:33"/"mock:20": in-process mock engine
 
     // ECI function pointers
     eciNewFunc              fnNew = nullptr;
@@ -201,14 +837,18 @@ struct ELOQ_STATE {
     eciNewDictFunc          fnNewDict = nullptr;
     eciSetDictFunc          fnSetDict = nullptr;
     eciLoadDictFunc         fnLoadDict = nullptr;
+    eciUpdateDictFunc       fnUpdateDict = nullptr;
+    eciDeleteDictFunc       fnDeleteDict = nullptr;
 
     // ECI handle
     void* handle = nullptr;
-    int dictHandle = -1;
+    int dictHandle = 0; // worker-owned; 0 = none (NULL_DICT_HAND)
 
-    // 3.3: output buffer (3300 samples * 2 bytes = 6600)
-    static const int kSamples = 3300;
-    char eciBuffer[3300 * 2] = {};
+    // 3.3: engine output buffer, one callback per fill. Smaller buffers get
+    // first audio out sooner, larger ones cost fewer callbacks. Resized and
+    // re-registered by the worker between utterances (eloq_set_output_buffer).
+    SettingInt eciBufferSamples; // requested size in samples
+    std::vector<short> eciBuffer;  // worker-owned, registered with the engine
 
     // Audio format
     WAVEFORMATEX lastFormat = {};
@@ -224,44 +864,231 @@ struct ELOQ_STATE {
     HANDLE stopEvent = nullptr;
     HANDLE cmdEvent = nullptr;
     HANDLE initEvent = nullptr;
+    HANDLE dataEvent = nullptr; // manual-reset; set when audio/markers are published or on stop
+    HANDLE chunkEvent = nullptr; // manual-reset; set when the engine reaches a chunk boundary
+    HANDLE promoteEvent = nullptr; // manual-reset; set when staged output is promoted or dropped
+    HANDLE drainEvent = nullptr; // manual-reset; set when a throttled producer may resume
+    HANDLE preemptEvent = nullptr; // manual-reset; set while urgent commands are waiting
     std::atomic<int> initOk{ 0 };
+    std::atomic<bool> shuttingDown{ false }; // set by destroyInstance before the worker is joined
+
+    // Warm-up after init (see warmUp). warming routes producer output to
+    // warmPipeline instead of the queue; worker-owned.
+    bool warmup = true;
+    bool warming = false;
+    std::atomic<int> warmState{ 0 }; // 0 until warm-up ends, then ELOQ_READY_*
 
     // Cancel + generations
     std::atomic<uint32_t> cancelToken{ 1 };
     std::atomic<uint32_t> genCounter{ 1 };
     std::atomic<uint32_t> activeGen{ 0 };
     std::atomic<uint32_t> currentGen{ 0 };
+    // Generation being produced off the stream: a lookahead staged behind
+    // currentGen (staged == true) or an offline render. 0 = none.
+    std::atomic<uint32_t> sideGen{ 0 };
 
     // Output pacing (2.0 only)
     std::atomic<uint64_t> bytesPerSec{ 0 };
 
-    // Silence trimming (2.0 only): cap consecutive silence to maxSilenceSamples.
+    // Per-utterance synthesis timeout: base + perByte * bytes handed to the
+    // engine, restarted whenever another chunk is fed.
+    std::atomic<int> timeoutBaseMs{ 10000 };
+    std::atomic<int> timeoutPerByteMs{ 60 };
+
+    // Stop latency: stopRequestUs is stamped by eloq_stop/eloq_speak; the
+    // worker measures up to the point the engine is stopped and quiet.
+    std::atomic<int64_t> stopRequestUs{ 0 };
+    LatencyStat stopLatency;
+
+    // eloq_get_stats. speakRequestUs is stamped by eloq_speak and consumed
+    // when the first audio of the utterance is published to the ring.
+    // Engine audio bytes and synthesis time feed the real-time factor.
+    std::atomic<int64_t> speakRequestUs{ 0 };
+    LatencyStat firstAudioLatency;
+    std::atomic<uint32_t> utterAudioBytes{ 0 };
+    std::atomic<uint32_t> statUtterances{ 0 };
+    std::atomic<uint32_t> statRtfLast{ 0 };
+    std::atomic<uint64_t> statSynthUs{ 0 };
+    std::atomic<uint64_t> statAudioUs{ 0 };
+    std::atomic<uint32_t> statSonicBuffers{ 0 };
+    std::atomic<uint32_t> statSonicMaxUs{ 0 };
+    std::atomic<uint64_t> statSonicUs{ 0 };
+    std::atomic<uint64_t> statTrimmedBytes{ 0 };
+    std::atomic<uint32_t> statQueuedPeak{ 0 };
+    std::atomic<uint32_t> statMarkersPeak{ 0 };
+    std::atomic<uint64_t> statOverrunBytes{ 0 };
+    std::atomic<uint32_t> statDroppedBuffers{ 0 };
+    std::atomic<uint32_t> statDroppedMarkers{ 0 };
+    std::atomic<uint64_t> statDroppedBytes{ 0 };
+
+    // Silence trimming: cap consecutive silence to maxSilenceSamples.
     uint32_t silenceSamples = 0;
     uint32_t maxSilenceSamples = 0; // 0 = disabled; set from sample rate after format detection
 
-    // Sonic rate boost: speed up audio without pitch change.
+    // Sonic rate boost: speed up audio without pitch change. The stream is
+    // created once the format is known and reused (reset, never destroyed)
+    // across utterances; rateBoost is worker-owned and only changes in
+    // applyDirtySettings, between utterances.
     sonicStream sonicStream = nullptr;
     float rateBoost = 1.0f; // 1.0 = normal, 1.5 = 50% faster, 2.0 = 2x
 
+    // Output format (eloq_set_output_format). Resampling runs as sonic's
+    // rate in the same pass as the speed change, and bit-depth conversion
+    // (including 32-bit float) in its read. The applied values are
+    // worker-owned, 0 = engine native.
+    SettingInt outRate;
+    SettingInt outBits;
+    int outRateApplied = 0;
+    int outBitsApplied = 0;
+
+    // Output gain in percent (eloq_set_gain). Read on every read, so it
+    // needs no settings pass and applies mid-utterance.
+    std::atomic<int> gainPct{ 100 };
+
     // Voice settings (dirty-tracked, applied on worker before synthesis)
     SettingInt vparams[8]; // index 1-7 maps to ECI voice param IDs
     SettingInt variant;
     SettingInt voice; // param 9 (3.3: language ID)
+    SettingInt rateBoostPct; // sonic speed in percent (100 = off)
 
     int currentVariant = 0;
     int currentVoice = 0;
 
+    // Every setter bumps settingsVersion once its values are stored (a batch
+    // from eloq_set_params bumps it once); the worker skips applying when it
+    // still matches appliedVersion. appliedVparams mirrors the engine so only
+    // net changes cost an engine call.
+    std::atomic<uint32_t> settingsVersion{ 0 };
+    uint32_t appliedVersion = 0; // worker-owned
+    int appliedVparams[8] = {};  // worker-owned
+
+    // 3.3: several voice param changes at once are sent as inline
+    // annotations ahead of the next text instead of one call each.
+    std::atomic<int> inlineParams{ 1 };
+    std::string inlinePrefix; // worker-owned, not yet sent to the engine
+    unsigned inlineMask = 0;  // vparams carried by inlinePrefix
+
+    // Text chunking: long utterances are fed to the engine in pieces of at
+    // most chunkBytes (0 = whole text at once), each followed by a boundary
+    // index so the next piece is added while the current one is spoken.
+    std::atomic<int> chunkBytes{ 1024 };
+    std::vector<std::string> textChunks; // worker-owned
+
+    // Text rules (eloq_load_rules). Loaders swap the shared_ptr under
+    // rulesMtx; the worker takes a reference per utterance. charMap is the
+    // per-byte substitution applied outside rule matches.
+    std::mutex rulesMtx;
+    std::shared_ptr<const RuleSet> rules;
+    uint8_t charMap[256] = {};
+    std::string ruleText; // worker-owned scratch
+
+    // Offline render in progress (worker-owned). While set, audio and
+    // markers of the current generation go to the job instead of the ring.
+    RenderJob* render = nullptr;
+
+    // Phrase cache (worker-owned). While capturing, everything the current
+    // generation publishes is also recorded for insertion at DONE.
+    PhraseCache phraseCache;
+    bool capturing = false;
+    std::vector<uint8_t> capturePcm;
+    std::vector<StreamMarker> captureMarkers;
+    std::atomic<int> cacheMaxBytes{ 2 * 1024 * 1024 }; // 0 = disabled
+    std::atomic<uint32_t> cacheHits{ 0 };
+    std::atomic<uint32_t> cacheMisses{ 0 };
+    std::atomic<uint32_t> cacheEntries{ 0 };
+    std::atomic<uint32_t> cacheBytes{ 0 };
+    std::atomic<uint32_t> dictVersion{ 0 }; // bumped by eloq_load_dict; part of the fingerprint
+
+    // Dictionary manager. dictMtx serializes loaders and guards dictPaths
+    // (the last source per volume, reused when a path is NULL). The swap is
+    // handed to the worker through pendingDict under cmdMtx.
+    std::mutex dictMtx;
+    std::string dictPaths[2];
+    std::shared_ptr<DictLoad> pendingDict;
+    std::atomic<int> dictResult{ 0 };
+    std::atomic<uint32_t> dictLoads{ 0 };
+    std::atomic<uint32_t> dictMainEntries{ 0 };
+    std::atomic<uint32_t> dictRootEntries{ 0 };
+    std::atomic<uint32_t> dictSkipped{ 0 };
+    std::atomic<uint32_t> dictRejected{ 0 };
+    std::atomic<uint32_t> dictCacheHits{ 0 };
+    std::atomic<uint32_t> dictParseUs{ 0 };
+    std::atomic<uint32_t> dictLoadUs{ 0 };
+
     // Command queue
     std::mutex cmdMtx;
     std::deque<Cmd> cmdQ;
     std::thread worker;
 
-    // Output queue
+    // Urgent lane (eloq_speak_ex), served before cmdQ; urgentPending mirrors
+    // its size for the worker's wait loops. urgentGens holds the urgent
+    // generations that can still be queued for the reader (current and
+    // staged; worker-owned).
+    std::deque<Cmd> urgentQ;
+    std::atomic<int> urgentPending{ 0 };
+    uint32_t urgentGens[2] = {};
+    int urgentSlot = 0;
+
+    // Resume point of the generation being synthesized (outMtx): the next
+    // chunk to speak and where the generation's output stood when the
+    // engine reached it, as a ring position or, while staged, a stage
+    // offset. resumeChunkRaw is the last boundary index, -1 before one.
+    uint32_t resumeGen = 0;
+    int resumeChunkRaw = -1;
+    uint64_t resumePos = 0;
+    bool resumeInRing = false;
+
+    // Output queue. The ring holds audio of a single generation (outGen);
+    // one producer (ECI callback / waveOut hook / worker tail flush) and one
+    // consumer (eloq_read). outMtx guards positions and markers only.
     std::mutex outMtx;
-    std::deque<StreamItem> outQ;
-    size_t queuedAudioBytes = 0;
+    PcmRing pcm;
+    MarkerRing markers;
+    uint32_t outGen = 0;
+    uint64_t outBase = 0; // pcm position where outGen's audio starts
+    int ringBits = 16;    // sample size of outGen's audio
+
+    // Read side of the gain stage (outMtx): how far the ring has been
+    // scaled, the gain reached by the last sample and the ramp toward
+    // gainPct, and the time spent (for eloq_bench_stages).
+    uint64_t gainedPos = 0;
+    float gainCur = 1.0f;
+    float gainTarget = 1.0f;
+    float gainStep = 0.0f;
+    uint64_t gainUs = 0;
     size_t maxBufferedBytes = 4 * 1024 * 1024;
+
+    // Flow control (outMtx): a producer that pushes the ring past
+    // highWaterBytes blocks in throttleProducer until the reader has drained
+    // it to lowWaterBytes. The byte marks are derived from the millisecond
+    // settings and the output format before each utterance; 0 = off. Time
+    // spent throttled is credited to the synthesis watchdog.
+    std::atomic<int> highWaterMs{ 10000 };
+    std::atomic<int> lowWaterMs{ 5000 };
+    size_t highWaterBytes = 0;
+    size_t lowWaterBytes = 0;
+    bool throttled = false;
+    std::atomic<uint32_t> throttleMs{ 0 };
+
+    // Lookahead staging (outMtx): output of sideGen held back until the
+    // reader consumes currentGen's DONE, then moved into the ring.
+    bool staged = false;
+    std::vector<uint8_t> stagePcm;
+    std::vector<StreamMarker> stageMarkers; // bytePos relative to stagePcm
+    int stageBits = 16;
     size_t maxQueueItems = 8192;
+
+    // Producer scratch for trimming / sonic output. Reused across buffers
+    // so the steady-state capture path does not allocate.
+    std::vector<uint8_t> trimBuf;
+    std::vector<uint8_t> sonicBuf;
+
+    // Sonic input/output frame counts for the running generation, and the
+    // INDEX markers held back until sonic's output reaches them (producer
+    // thread; bytePos holds the target output frame).
+    uint64_t sonicInFrames = 0;
+    uint64_t sonicOutFrames = 0;
+    std::vector<StreamMarker> sonicMarkers;
 };
 
 static ELOQ_STATE* g_state = nullptr;
@@ -270,29 +1097,58 @@ static std::mutex g_globalMtx;
 // ------------------------------------------------------------
 // Helpers
 // ------------------------------------------------------------
-static bool isCallerFromEloquence(ELOQ_STATE* s, void* ra) {
-    if (!s) return false;
-    HMODULE caller = nullptr;
-    if (!GetModuleHandleExW(
-        GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
-        reinterpret_cast<LPCWSTR>(ra),
-        &caller
-    )) {
-        dbg("isCallerFromEloquence: GetModuleHandleExW failed for ra=%p", ra);
-        return false;
-    }
-    if (!caller) return false;
-    if (caller == s->eciModule) return true;
-    if (s->engsynModule && caller == s->engsynModule) return true;
-    if (s->cwlModule && caller == s->cwlModule) return true;
+// Address ranges of the Eloquence 2.0 modules, so the waveOutOpen hook can
+// classify its caller without a loader call. Filled by the worker after
+// loading (readers only ever see fully written entries below the count).
+struct ModuleRange {
+    uintptr_t lo;
+    uintptr_t hi;
+};
+static const int kMaxEloqModules = 4; // ECI32D, ENGSYN32, CW3220MT, Speech
+static ModuleRange g_eloqRanges[kMaxEloqModules];
+static std::atomic<int> g_eloqRangeCount{ 0 };
+static std::mutex g_eloqRangeMtx; // writers only
+static std::atomic<bool> g_speechRangeKnown{ false }; // Speech.dll's range is in the table
+
+static void addModuleRange(HMODULE m) {
+    if (!m) return;
+    const uint8_t* base = reinterpret_cast<const uint8_t*>(m);
+    const IMAGE_DOS_HEADER* dos = reinterpret_cast<const IMAGE_DOS_HEADER*>(base);
+    const IMAGE_NT_HEADERS* nt = reinterpret_cast<const IMAGE_NT_HEADERS*>(base + dos->e_lfanew);
+    const uintptr_t lo = reinterpret_cast<uintptr_t>(base);
+    const uintptr_t hi = lo + nt->OptionalHeader.SizeOfImage;
+
+    std::lock_guard<std::mutex> lk(g_eloqRangeMtx);
+    const int n = g_eloqRangeCount.load(std::memory_order_relaxed);
+    for (int i = 0; i < n; i++)
+        if (g_eloqRanges[i].lo == lo) return;
+    if (n >= kMaxEloqModules) return;
+    g_eloqRanges[n].lo = lo;
+    g_eloqRanges[n].hi = hi;
+    g_eloqRangeCount.store(n + 1, std::memory_order_release);
+}
+
+// Forgets the ranges once the engine that owned them is gone, so a module
+// loaded at the same address later is not taken for the engine and a
+// reloaded engine gets a free table.
+static void clearModuleRanges() {
+    std::lock_guard<std::mutex> lk(g_eloqRangeMtx);
+    g_eloqRangeCount.store(0, std::memory_order_release);
+    g_speechRangeKnown.store(false, std::memory_order_relaxed);
+}
 
-    // Log the unknown caller module for debugging.
-    char modName[MAX_PATH] = {};
-    GetModuleFileNameA(caller, modName, MAX_PATH);
-    dbg("isCallerFromEloquence: REJECTED caller=%p (%s) ra=%p", caller, modName, ra);
+static bool isCallerFromEloquence(void* ra) {
+    const uintptr_t a = reinterpret_cast<uintptr_t>(ra);
+    const int n = g_eloqRangeCount.load(std::memory_order_acquire);
+    for (int i = 0; i < n; i++)
+        if (a >= g_eloqRanges[i].lo && a < g_eloqRanges[i].hi) return true;
     return false;
 }
 
+// The 2.0 instance the waveOut hooks capture for; null = disarmed. The
+// hooks themselves are only enabled in MinHook while this is set.
+static std::atomic<ELOQ_STATE*> g_hookTarget{ nullptr };
+
 static void signalWaveOutMessage(ELOQ_STATE* s, UINT msg, WAVEHDR* hdr) {
     if (!s) return;
     const DWORD cbType = (s->callbackType & CALLBACK_TYPEMASK);
@@ -335,239 +1191,1910 @@ static void signalWaveOutMessage(ELOQ_STATE* s, UINT msg, WAVEHDR* hdr) {
     }
 }
 
+// Lets a throttled producer continue once the reader has drained the ring
+// to the low-water mark. Caller holds outMtx.
+static void releaseProducerLocked(ELOQ_STATE* s) {
+    if (s->throttled && s->pcm.size() <= s->lowWaterBytes && s->drainEvent)
+        SetEvent(s->drainEvent);
+}
+
 static void clearOutputQueueLocked(ELOQ_STATE* s) {
-    s->outQ.clear();
-    s->queuedAudioBytes = 0;
+    s->pcm.readPos = s->pcm.writePos;
+    s->outBase = s->pcm.writePos;
+    s->markers.clear();
+    releaseProducerLocked(s);
 }
 
-static void pushAudioToQueue(ELOQ_STATE* s, uint32_t gen, std::vector<uint8_t> buf);
+// Read-side generation filter: what is left belongs to a canceled utterance.
+static void dropStaleOutputLocked(ELOQ_STATE* s) {
+    if (s->pcm.size()) {
+        s->statDroppedBuffers.fetch_add(1, std::memory_order_relaxed);
+        s->statDroppedBytes.fetch_add(s->pcm.size(), std::memory_order_relaxed);
+    }
+    s->statDroppedMarkers.fetch_add((uint32_t)s->markers.size(), std::memory_order_relaxed);
+    clearOutputQueueLocked(s);
+}
 
-static void enqueueAudioFromHook(ELOQ_STATE* s, uint32_t gen, const void* data, size_t size) {
-    if (!s || !data || size == 0) return;
+// Drops staged lookahead output and releases a worker waiting on it.
+static void clearStageLocked(ELOQ_STATE* s) {
+    if (s->staged) {
+        s->staged = false;
+        s->sideGen.store(0, std::memory_order_relaxed);
+    }
+    s->stagePcm.clear();
+    s->stageMarkers.clear();
+    if (s->promoteEvent) SetEvent(s->promoteEvent);
+}
 
-    const uint8_t* src = static_cast<const uint8_t*>(data);
-    std::vector<uint8_t> buf;
-
-    // Silence trimming for mode 20: cap runs of silence to maxSilenceSamples.
-    if (s->mode == ELOQ_MODE_20 && s->maxSilenceSamples > 0 && s->formatValid) {
-        const int bps = s->lastFormat.wBitsPerSample;
-        const int nch = s->lastFormat.nChannels;
-        const int frameSize = (bps / 8) * nch;
-
-        if (frameSize > 0 && (bps == 8 || bps == 16)) {
-            buf.reserve(size);
-            for (size_t i = 0; i + (size_t)frameSize <= size; i += frameSize) {
-                bool silent = true;
-                if (bps == 8) {
-                    for (int c = 0; c < nch && silent; c++) {
-                        uint8_t v = src[i + c];
-                        if (v < 124 || v > 132) silent = false;
-                    }
-                } else {
-                    for (int c = 0; c < nch && silent; c++) {
-                        int16_t v;
-                        memcpy(&v, &src[i + c * 2], sizeof(v));
-                        if (v < -128 || v > 128) silent = false;
-                    }
-                }
-                if (silent) {
-                    if (++s->silenceSamples <= s->maxSilenceSamples)
-                        buf.insert(buf.end(), src + i, src + i + frameSize);
-                } else {
-                    s->silenceSamples = 0;
-                    buf.insert(buf.end(), src + i, src + i + frameSize);
-                }
-            }
-            if (buf.empty()) return;
-        } else {
-            buf.assign(src, src + size);
-        }
-    } else {
-        buf.assign(src, src + size);
-    }
-
-    // Sonic rate boost: time-stretch without pitch change.
-    if (s->rateBoost > 1.001f && s->formatValid) {
-        const int bps = s->lastFormat.wBitsPerSample;
-        const int nch = s->lastFormat.nChannels;
-        const int frameSize = (bps / 8) * nch;
-        if (frameSize > 0 && (bps == 8 || bps == 16)) {
-            if (!s->sonicStream) {
-                s->sonicStream = sonicCreateStream(s->lastFormat.nSamplesPerSec, nch);
-                sonicSetSpeed(s->sonicStream, s->rateBoost);
-            }
-            int numSamples = (int)(buf.size() / frameSize);
-            if (bps == 8)
-                sonicWriteUnsignedCharToStream(s->sonicStream, buf.data(), numSamples);
-            else
-                sonicWriteShortToStream(s->sonicStream, reinterpret_cast<short*>(buf.data()), numSamples);
-
-            int avail = sonicSamplesAvailable(s->sonicStream);
-            if (avail > 0) {
-                buf.resize(avail * frameSize);
-                if (bps == 8)
-                    sonicReadUnsignedCharFromStream(s->sonicStream, buf.data(), avail);
-                else
-                    sonicReadShortFromStream(s->sonicStream, reinterpret_cast<short*>(buf.data()), avail);
-            } else {
-                return; // Sonic is buffering internally, no output yet.
-            }
-        }
-        if (buf.empty()) return;
+// Makes the staged generation current once the reader has consumed the
+// previous generation's DONE. Caller holds outMtx.
+static void promoteStagedLocked(ELOQ_STATE* s) {
+    if (!s->staged) return;
+    const uint32_t gen = s->sideGen.load(std::memory_order_relaxed);
+    clearOutputQueueLocked(s);
+    s->outGen = gen;
+    s->currentGen.store(gen, std::memory_order_relaxed);
+    s->ringBits = s->stageBits;
+
+    const uint64_t base = s->pcm.writePos;
+    const size_t n = std::min(s->stagePcm.size(), s->pcm.capacity());
+    s->pcm.copyIn(base, s->stagePcm.data(), n);
+    s->pcm.writePos = base + n;
+    if (s->resumeGen == gen && !s->resumeInRing) {
+        s->resumePos = base + std::min<uint64_t>(s->resumePos, n);
+        s->resumeInRing = true;
+    }
+    for (const StreamMarker& m : s->stageMarkers) {
+        StreamMarker t = m;
+        t.bytePos = base + std::min<uint64_t>(m.bytePos, n);
+        s->markers.push(t);
     }
+    s->staged = false;
+    s->sideGen.store(0, std::memory_order_relaxed);
+    s->stagePcm.clear();
+    s->stageMarkers.clear();
+    dbg("promote: gen=%u bytes=%zu", gen, n);
+    if (s->promoteEvent) SetEvent(s->promoteEvent);
+    if (s->dataEvent) SetEvent(s->dataEvent);
+}
+
+// True while gen may still publish: the reader's generation or the side one.
+static inline bool genLive(ELOQ_STATE* s, uint32_t gen) {
+    return gen != 0 && (gen == s->currentGen.load(std::memory_order_relaxed) ||
+                        gen == s->sideGen.load(std::memory_order_relaxed));
+}
 
-    pushAudioToQueue(s, gen, std::move(buf));
+static bool isUrgentGen(const ELOQ_STATE* s, uint32_t gen) {
+    return gen != 0 && (gen == s->urgentGens[0] || gen == s->urgentGens[1]);
 }
 
-static void pushAudioToQueue(ELOQ_STATE* s, uint32_t gen, std::vector<uint8_t> buf) {
-    if (buf.empty()) return;
+// Where gen's next output lands: a ring position while it is the reader's
+// generation, otherwise an offset into the stage. Caller holds outMtx.
+static uint64_t genOutputPosLocked(const ELOQ_STATE* s, uint32_t gen) {
+    return gen == s->currentGen.load(std::memory_order_relaxed)
+        ? s->pcm.writePos : (uint64_t)s->stagePcm.size();
+}
 
+// Resets the resume point to the generation's current output position.
+static void markResumeStart(ELOQ_STATE* s, uint32_t gen) {
     std::lock_guard<std::mutex> g(s->outMtx);
-    const uint32_t curGen = s->currentGen.load(std::memory_order_relaxed);
-    if (curGen == 0 || gen != curGen) return;
-
-    const size_t limit = s->maxBufferedBytes;
-    // Drop oldest audio if full.
-    while ((s->queuedAudioBytes + buf.size() > limit) || (s->outQ.size() >= s->maxQueueItems)) {
-        bool found = false;
-        for (auto it = s->outQ.begin(); it != s->outQ.end(); ++it) {
-            if (it->type == ELOQ_ITEM_AUDIO) {
-                size_t remaining = (it->data.size() > it->offset) ? (it->data.size() - it->offset) : 0;
-                if (s->queuedAudioBytes >= remaining) s->queuedAudioBytes -= remaining;
-                else s->queuedAudioBytes = 0;
-                s->outQ.erase(it);
-                found = true;
-                break;
-            }
+    s->resumeGen = gen;
+    s->resumeChunkRaw = -1;
+    s->resumePos = genOutputPosLocked(s, gen);
+    s->resumeInRing = gen == s->currentGen.load(std::memory_order_relaxed);
+}
+
+// The engine finished a chunk: gen can resume from the next one.
+static void noteChunkBoundary(ELOQ_STATE* s, uint32_t gen, int chunk) {
+    std::lock_guard<std::mutex> g(s->outMtx);
+    if (s->resumeGen != gen) return;
+    s->resumeChunkRaw = chunk;
+    s->resumePos = genOutputPosLocked(s, gen);
+    s->resumeInRing = gen == s->currentGen.load(std::memory_order_relaxed);
+}
+
+// Moves gen's unread output up to limit (a ring position or stage offset,
+// as genOutputPosLocked) into e, index markers rebased onto e.pcm, and
+// drops the rest. Caller holds outMtx.
+static void takeOutputLocked(ELOQ_STATE* s, uint32_t gen, uint64_t limit, PhraseEntry& e) {
+    if (gen != 0 && gen == s->currentGen.load(std::memory_order_relaxed)) {
+        if (s->outGen != gen) return;
+        const uint64_t from = s->pcm.readPos;
+        const uint64_t to = std::max(from, std::min(limit, s->pcm.writePos));
+        e.pcm.resize((size_t)(to - from));
+        if (to > from) s->pcm.copyOut(from, e.pcm.data(), (size_t)(to - from));
+        for (size_t i = 0; i < s->markers.size(); i++) {
+            const StreamMarker& m = s->markers.at(i);
+            if (m.type != ELOQ_ITEM_INDEX || m.bytePos > to) continue;
+            StreamMarker t = m;
+            t.bytePos = m.bytePos > from ? m.bytePos - from : 0;
+            e.markers.push_back(t);
         }
-        if (!found) return;
+        clearOutputQueueLocked(s);
+    } else if (s->staged && gen == s->sideGen.load(std::memory_order_relaxed)) {
+        const size_t to = (size_t)std::min<uint64_t>(limit, s->stagePcm.size());
+        e.pcm.assign(s->stagePcm.begin(), s->stagePcm.begin() + to);
+        for (const StreamMarker& m : s->stageMarkers)
+            if (m.type == ELOQ_ITEM_INDEX && m.bytePos <= to) e.markers.push_back(m);
+        clearStageLocked(s);
     }
+}
 
-    const size_t bufSize = buf.size();
-    StreamItem it(ELOQ_ITEM_AUDIO, 0, gen);
-    it.data = std::move(buf);
-    s->queuedAudioBytes += bufSize;
-    s->outQ.push_back(std::move(it));
+// True when audio has to go through sonic: a rate boost or a conversion to
+// a non-native output format.
+static bool sonicActive(const ELOQ_STATE* s) {
+    return s->sonicStream && s->formatValid &&
+        (s->rateBoost > 1.001f || s->outRateApplied || s->outBitsApplied);
 }
 
-static void pushMarker(ELOQ_STATE* s, int type, int value, uint32_t gen) {
-    std::lock_guard<std::mutex> g(s->outMtx);
-    const uint32_t curGen = s->currentGen.load(std::memory_order_relaxed);
-    if (curGen == 0 || gen != curGen) return;
-    s->outQ.push_back(StreamItem(type, value, gen));
+// Format of the PCM handed to clients: the engine's, with the applied
+// output rate and bit depth. 32 bits means IEEE float.
+static WAVEFORMATEX outputFormat(const ELOQ_STATE* s) {
+    WAVEFORMATEX f = s->lastFormat;
+    if (s->outRateApplied) f.nSamplesPerSec = (DWORD)s->outRateApplied;
+    if (s->outBitsApplied) f.wBitsPerSample = (WORD)s->outBitsApplied;
+    if (f.wBitsPerSample == 32) f.wFormatTag = WAVE_FORMAT_IEEE_FLOAT;
+    f.nBlockAlign = (WORD)(f.nChannels * (f.wBitsPerSample / 8));
+    f.nAvgBytesPerSec = f.nSamplesPerSec * f.nBlockAlign;
+    return f;
+}
+
+// Output frames in a byte count of client PCM.
+static uint32_t frameCount(const ELOQ_STATE* s, uint64_t bytes) {
+    const uint64_t fb = outputFormat(s).nBlockAlign;
+    return fb ? (uint32_t)std::min<uint64_t>(bytes / fb, UINT32_MAX) : 0;
 }
 
 // ------------------------------------------------------------
-// ECI callback (shared by both modes, called on worker thread)
+// Silence trimming kernel
 // ------------------------------------------------------------
-static int __cdecl eciCallback(int h, int msgType, int length, void* data) {
-    ELOQ_STATE* s = g_state;
-    if (!s) { dbg("eciCallback: g_state NULL"); return 2; }
-
-    const uint32_t gen = s->activeGen.load(std::memory_order_relaxed);
-    const uint32_t curGen = s->currentGen.load(std::memory_order_relaxed);
-    dbg("eciCallback: msg=%d len=%d gen=%u curGen=%u", msgType, length, gen, curGen);
-    if (gen == 0 || gen != curGen) { dbg("eciCallback: gen mismatch, dropping"); return 2; }
-
-    if (s->mode == ELOQ_MODE_33 && msgType == 0) {
-        if (length > 0) {
-            // 3.3: Audio data in output buffer.
-            size_t bytes = (size_t)length * 2;
-            if (bytes > sizeof(s->eciBuffer)) bytes = sizeof(s->eciBuffer);
-            dbg("eciCallback: enqueueing %zu audio bytes", bytes);
-            enqueueAudioFromHook(s, gen, s->eciBuffer, bytes);
-        } else {
-            // 3.3: length==0 means end of synthesis (no 0xFFFF in this mode).
-            dbg("eciCallback: DONE (msg=0, len=0)");
-            if (s->doneEvent) SetEvent(s->doneEvent);
+// A frame is silent when every channel sample is inside the noise band
+// (8-bit: 124..132, 16-bit: -128..128). Runs of silence longer than
+// maxSilenceSamples are cut; the running count carries across buffers in
+// silenceSamples. Scans work on 16-byte blocks (frame sizes 1/2/4/8/16
+// align with them); runs are copied out with one memmove each.
+static bool frameIsSilent(const uint8_t* p, int bps, int nch) {
+    if (bps == 8) {
+        for (int c = 0; c < nch; c++)
+            if (p[c] < 124 || p[c] > 132) return false;
+    } else {
+        for (int c = 0; c < nch; c++) {
+            int16_t v;
+            memcpy(&v, p + c * 2, sizeof(v));
+            if (v < -128 || v > 128) return false;
         }
     }
+    return true;
+}
 
-    if (msgType == 2) {
-        if (length == 0xFFFF) {
-            // End of utterance (2.0 style).
-            dbg("eciCallback: DONE (0xFFFF)");
-            if (s->doneEvent) SetEvent(s->doneEvent);
-        } else {
-            // Index marker.
-            dbg("eciCallback: INDEX %d", length);
-            pushMarker(s, ELOQ_ITEM_INDEX, length, gen);
-        }
+#if ELOQ_HAVE_SSE2
+// Per-byte loudness mask for 16 bytes: bit b is set when byte b belongs to
+// a sample outside the noise band.
+static inline unsigned loudMask16(const uint8_t* p, int bps) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i loud;
+    if (bps == 8) {
+        // Recentre unsigned 8-bit on zero: silent is -4..4.
+        v = _mm_xor_si128(v, _mm_set1_epi8((char)0x80));
+        loud = _mm_or_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(4)),
+                            _mm_cmplt_epi8(v, _mm_set1_epi8(-4)));
+    } else {
+        loud = _mm_or_si128(_mm_cmpgt_epi16(v, _mm_set1_epi16(128)),
+                            _mm_cmplt_epi16(v, _mm_set1_epi16(-128)));
     }
-
-    return 1;
+    return (unsigned)_mm_movemask_epi8(loud);
 }
 
-// ------------------------------------------------------------
-// WaveOut hooks (2.0 only)
-// ------------------------------------------------------------
-static MMRESULT WINAPI hook_waveOutOpen(
-    LPHWAVEOUT phwo,
-    UINT uDeviceID,
-    LPCWAVEFORMATEX pwfx,
-    DWORD_PTR dwCallback,
-    DWORD_PTR dwInstance,
-    DWORD fdwOpen
-) {
-    ELOQ_STATE* s = g_state;
-    // For mode 20: intercept ALL waveOutOpen calls. In the bridge host
-    // process, the only waveOut caller is the Eloquence engine (via
-    // Speech.dll). NVDA 2026.1's nvwave uses WASAPI, not waveOut.
-    bool fromEloq = s && s->mode == ELOQ_MODE_20;
-    dbg("hook_waveOutOpen: fromEloq=%d mode=%d", fromEloq, s ? s->mode : -1);
-    if (!fromEloq) {
-        return g_waveOutOpenOrig ? g_waveOutOpenOrig(phwo, uDeviceID, pwfx, dwCallback, dwInstance, fdwOpen)
-            : MMSYSERR_ERROR;
+// Folds a byte mask to one bit per frame, kept at each frame's first byte.
+static inline unsigned frameMask16(unsigned m, int frameSize) {
+    switch (frameSize) {
+    case 1:  return m;
+    case 2:  m |= m >> 1; return m & 0x5555u;
+    case 4:  m |= m >> 1; m |= m >> 2; return m & 0x1111u;
+    case 8:  m |= m >> 1; m |= m >> 2; m |= m >> 4; return m & 0x0101u;
+    default: return m ? 1u : 0u; // 16
     }
+}
 
-    HWAVEOUT fakeHandle = reinterpret_cast<HWAVEOUT>(s);
-    if (phwo) *phwo = fakeHandle;
-    s->eloqWaveHandle = fakeHandle;
+static inline unsigned frameSelect16(int frameSize) {
+    switch (frameSize) {
+    case 1:  return 0xFFFFu;
+    case 2:  return 0x5555u;
+    case 4:  return 0x1111u;
+    case 8:  return 0x0101u;
+    default: return 0x0001u;
+    }
+}
 
-    if (pwfx) {
-        s->lastFormat = *pwfx;
-        s->formatValid = true;
+static inline unsigned lowestBit(unsigned m) {
+    unsigned long idx;
+    _BitScanForward(&idx, m);
+    return (unsigned)idx;
+}
+#endif
 
-        uint64_t bps = (uint64_t)pwfx->nAvgBytesPerSec;
-        if (!bps && pwfx->nSamplesPerSec && pwfx->nBlockAlign)
-            bps = (uint64_t)pwfx->nSamplesPerSec * (uint64_t)pwfx->nBlockAlign;
-        if (!bps) bps = 22050;
-        s->bytesPerSec.store(bps, std::memory_order_relaxed);
+// Returns the offset of the first frame in [pos, end) whose loudness equals
+// wantLoud, or end. pos and end are frame aligned.
+static size_t scanFrames(const uint8_t* src, size_t pos, size_t end,
+    int bps, int nch, int frameSize, bool wantLoud) {
+#if ELOQ_HAVE_SSE2
+    if (16 % frameSize == 0) {
+        const unsigned sel = frameSelect16(frameSize);
+        for (; pos + 16 <= end; pos += 16) {
+            unsigned fm = frameMask16(loudMask16(src + pos, bps), frameSize);
+            if (!wantLoud) fm = ~fm & sel;
+            if (fm) return pos + lowestBit(fm);
+        }
+    }
+#endif
+    for (; pos < end; pos += frameSize)
+        if (frameIsSilent(src + pos, bps, nch) != wantLoud) return pos;
+    return end;
+}
 
-        // Silence trimming: cap at 60 ms of silence.
-        if (s->maxSilenceSamples == 0 && pwfx->nSamplesPerSec > 0)
-            s->maxSilenceSamples = pwfx->nSamplesPerSec * 60 / 1000;
+// Writes the trimmed frames of src into dst (capacity >= size) and returns
+// the number of bytes kept. Trailing partial frames are dropped.
+static size_t trimSilence(const uint8_t* src, size_t size, uint8_t* dst,
+    int bps, int nch, uint32_t maxSilence, uint32_t& silenceSamples) {
+    const int frameSize = (bps / 8) * nch;
+    const size_t end = size - (size % frameSize);
+    size_t pos = 0;
+    size_t out = 0;
+    while (pos < end) {
+        // Loud run: kept whole, resets the silence count.
+        size_t next = scanFrames(src, pos, end, bps, nch, frameSize, false);
+        if (next > pos) {
+            memmove(dst + out, src + pos, next - pos);
+            out += next - pos;
+            silenceSamples = 0;
+            pos = next;
+        }
+        if (pos >= end) break;
+
+        // Silent run: keep only what is left of the allowance.
+        next = scanFrames(src, pos, end, bps, nch, frameSize, true);
+        const uint32_t runFrames = (uint32_t)((next - pos) / frameSize);
+        const uint32_t allowance = (silenceSamples < maxSilence) ? (maxSilence - silenceSamples) : 0;
+        const uint32_t keepFrames = (runFrames < allowance) ? runFrames : allowance;
+        if (keepFrames) {
+            memmove(dst + out, src + pos, (size_t)keepFrames * frameSize);
+            out += (size_t)keepFrames * frameSize;
+        }
+        // Saturate: anything past the allowance behaves the same.
+        silenceSamples = (runFrames > allowance) ? maxSilence + 1 : silenceSamples + runFrames;
+        pos = next;
     }
+    return out;
+}
 
-    s->callbackType = fdwOpen;
-    s->callbackTarget = dwCallback;
-    s->callbackInstance = dwInstance;
+// ------------------------------------------------------------
+// Output gain and soft limiter
+// ------------------------------------------------------------
+// Volume is applied in place to queued client PCM just before the reader
+// copies it out, so a change is heard on the next read, without
+// re-synthesis and whatever the queue holds. A change ramps over
+// kGainRampSamples to avoid a click. Above unity a soft knee keeps peaks
+// under full scale: the part of a sample past the knee is compressed as
+// over / (1 + over / headroom), which joins the linear part with the same
+// slope and approaches full scale without reaching it.
+static const float kLimitKnee = 0.89f; // -1 dBFS
+static const int kGainRampSamples = 256;
+
+// One sample in full-scale units fs. Same operations as gainLimit4, so the
+// scalar ramp and tail match the SSE2 blocks exactly.
+static inline float gainSample(float x, float g, float fs, bool limit) {
+    const float y = x * g;
+    if (!limit) return y;
+    const float knee = kLimitKnee * fs;
+    const float invHead = 1.0f / (fs * (1.0f - kLimitKnee));
+    const float a = std::fabs(y);
+    if (a <= knee) return y;
+    const float over = a - knee;
+    const float lim = knee + over / (1.0f + over * invHead);
+    return y < 0.0f ? -lim : lim;
+}
 
-    signalWaveOutMessage(s, WOM_OPEN, nullptr);
-    return MMSYSERR_NOERROR;
+// Rounded with nearbyint (to nearest, ties to even in the default mode), as
+// _mm_cvtps_epi32 does in the SSE2 blocks, so a sample comes out the same
+// whichever path it takes.
+static inline int16_t gainS16(int16_t v, float g, bool limit) {
+    const float y = gainSample((float)v, g, 32767.0f, limit);
+    return (int16_t)std::max(-32768.0f, std::min(32767.0f, std::nearbyint(y)));
 }
 
-static MMRESULT WINAPI hook_waveOutPrepareHeader(HWAVEOUT hwo, LPWAVEHDR pwh, UINT cbwh) {
-    ELOQ_STATE* s = g_state;
-    if (!s || s->mode != ELOQ_MODE_20 || hwo != s->eloqWaveHandle) {
-        return g_waveOutPrepareHeaderOrig ? g_waveOutPrepareHeaderOrig(hwo, pwh, cbwh) : MMSYSERR_ERROR;
-    }
-    if (pwh) pwh->dwFlags |= WHDR_PREPARED;
-    return MMSYSERR_NOERROR;
+static inline uint8_t gainU8(uint8_t v, float g, bool limit) {
+    const float y = gainSample((float)((int)v - 128), g, 127.0f, limit);
+    return (uint8_t)(std::max(-128.0f, std::min(127.0f, std::nearbyint(y))) + 128.0f);
 }
 
-static MMRESULT WINAPI hook_waveOutUnprepareHeader(HWAVEOUT hwo, LPWAVEHDR pwh, UINT cbwh) {
-    ELOQ_STATE* s = g_state;
-    if (!s || s->mode != ELOQ_MODE_20 || hwo != s->eloqWaveHandle) {
-        return g_waveOutUnprepareHeaderOrig ? g_waveOutUnprepareHeaderOrig(hwo, pwh, cbwh) : MMSYSERR_ERROR;
-    }
-    if (pwh) pwh->dwFlags &= ~WHDR_PREPARED;
-    return MMSYSERR_NOERROR;
+#if ELOQ_HAVE_SSE2
+static inline __m128 gainLimit4(__m128 x, __m128 g, __m128 knee, __m128 invHead, bool limit) {
+    const __m128 y = _mm_mul_ps(x, g);
+    if (!limit) return y;
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 a = _mm_andnot_ps(sign, y);
+    const __m128 over = _mm_max_ps(_mm_sub_ps(a, knee), _mm_setzero_ps());
+    const __m128 lim = _mm_add_ps(_mm_min_ps(a, knee),
+        _mm_div_ps(over, _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(over, invHead))));
+    return _mm_or_ps(lim, _mm_and_ps(sign, y));
+}
+
+// Eight 16-bit samples widened to two float vectors and packed back with
+// saturation.
+static inline void gainBlockS16(uint8_t* p, __m128 g, bool limit) {
+    const __m128 knee = _mm_set1_ps(kLimitKnee * 32767.0f);
+    const __m128 invHead = _mm_set1_ps(1.0f / (32767.0f * (1.0f - kLimitKnee)));
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+    const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+    const __m128 flo = gainLimit4(_mm_cvtepi32_ps(lo), g, knee, invHead, limit);
+    const __m128 fhi = gainLimit4(_mm_cvtepi32_ps(hi), g, knee, invHead, limit);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p),
+        _mm_packs_epi32(_mm_cvtps_epi32(flo), _mm_cvtps_epi32(fhi)));
+}
+
+// Sixteen unsigned 8-bit samples, recentred on zero like loudMask16.
+static inline void gainBlockU8(uint8_t* p, __m128 g, bool limit) {
+    const __m128 knee = _mm_set1_ps(kLimitKnee * 127.0f);
+    const __m128 invHead = _mm_set1_ps(1.0f / (127.0f * (1.0f - kLimitKnee)));
+    const __m128i bias = _mm_set1_epi8((char)0x80);
+    const __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), bias);
+    const __m128i w[2] = { _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8),
+                           _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8) };
+    __m128i r[2];
+    for (int k = 0; k < 2; k++) {
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(w[k], w[k]), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(w[k], w[k]), 16);
+        r[k] = _mm_packs_epi32(
+            _mm_cvtps_epi32(gainLimit4(_mm_cvtepi32_ps(lo), g, knee, invHead, limit)),
+            _mm_cvtps_epi32(gainLimit4(_mm_cvtepi32_ps(hi), g, knee, invHead, limit)));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_xor_si128(_mm_packs_epi16(r[0], r[1]), bias));
+}
+
+static inline void gainBlockF32(uint8_t* p, __m128 g, bool limit) {
+    float* f = reinterpret_cast<float*>(p);
+    const __m128 knee = _mm_set1_ps(kLimitKnee);
+    const __m128 invHead = _mm_set1_ps(1.0f / (1.0f - kLimitKnee));
+    _mm_storeu_ps(f, gainLimit4(_mm_loadu_ps(f), g, knee, invHead, limit));
+}
+#endif
+
+// Scales bytes of client PCM (8, 16 or 32-bit float) in place: the ramp
+// sample by sample, then the constant part 16 bytes per SSE2 step. The
+// limiter only runs when the gain can push a sample past the knee.
+static void applyGain(ELOQ_STATE* s, uint8_t* p, size_t bytes, int bits) {
+    const int bps = bits / 8;
+    if (bps != 1 && bps != 2 && bps != 4) return;
+    const size_t n = bytes / bps;
+    size_t i = 0;
+    for (; i < n && s->gainCur != s->gainTarget; i++) {
+        const float g = s->gainCur + s->gainStep;
+        s->gainCur = (s->gainStep > 0.0f) ? std::min(g, s->gainTarget) : std::max(g, s->gainTarget);
+        const bool limit = s->gainCur > kLimitKnee;
+        if (bps == 1) {
+            p[i] = gainU8(p[i], s->gainCur, limit);
+        } else if (bps == 2) {
+            int16_t v;
+            memcpy(&v, p + i * 2, sizeof(v));
+            v = gainS16(v, s->gainCur, limit);
+            memcpy(p + i * 2, &v, sizeof(v));
+        } else {
+            float v;
+            memcpy(&v, p + i * 4, sizeof(v));
+            v = gainSample(v, s->gainCur, 1.0f, limit);
+            memcpy(p + i * 4, &v, sizeof(v));
+        }
+    }
+    const float g = s->gainCur;
+    if (i >= n || g == 1.0f) return;
+    const bool limit = g > kLimitKnee;
+    size_t pos = i * bps;
+#if ELOQ_HAVE_SSE2
+    const __m128 gv = _mm_set1_ps(g);
+    for (; pos + 16 <= bytes; pos += 16) {
+        if (bps == 1) gainBlockU8(p + pos, gv, limit);
+        else if (bps == 2) gainBlockS16(p + pos, gv, limit);
+        else gainBlockF32(p + pos, gv, limit);
+    }
+#endif
+    for (; pos + bps <= bytes; pos += bps) {
+        if (bps == 1) {
+            p[pos] = gainU8(p[pos], g, limit);
+        } else if (bps == 2) {
+            int16_t v;
+            memcpy(&v, p + pos, sizeof(v));
+            v = gainS16(v, g, limit);
+            memcpy(p + pos, &v, sizeof(v));
+        } else {
+            float v;
+            memcpy(&v, p + pos, sizeof(v));
+            v = gainSample(v, g, 1.0f, limit);
+            memcpy(p + pos, &v, sizeof(v));
+        }
+    }
+}
+
+// Picks up a gain change; false when the output passes at unity.
+static bool gainActive(ELOQ_STATE* s) {
+    const float target = (float)s->gainPct.load(std::memory_order_relaxed) / 100.0f;
+    if (target != s->gainTarget) {
+        s->gainTarget = target;
+        s->gainStep = (target - s->gainCur) / (float)kGainRampSamples;
+    }
+    return s->gainCur != 1.0f || s->gainTarget != 1.0f;
+}
+
+// Applies the gain in place to the ring audio a read is about to take, up
+// to the whole sample holding its last byte. gainedPos records how far it
+// got, so an odd-sized read never scales a sample twice. The ring capacity
+// is a multiple of every sample size, so the wrap point never splits a
+// sample either. Caller holds outMtx.
+static void gainReadLocked(ELOQ_STATE* s, size_t take) {
+    if (s->gainedPos < s->pcm.readPos) s->gainedPos = s->pcm.readPos;
+    const int bps = s->ringBits / 8;
+    if (bps <= 0 || take == 0) return;
+    const uint64_t want = s->pcm.readPos + take;
+    const uint64_t end = std::min<uint64_t>(s->pcm.writePos, (want + bps - 1) / bps * bps);
+    if (end <= s->gainedPos) return;
+    const uint64_t pos = s->gainedPos;
+    s->gainedPos = end;
+    if (!gainActive(s)) return;
+
+    const int64_t t0 = nowUs();
+    const size_t n = (size_t)(end - pos);
+    const size_t cap = s->pcm.capacity();
+    const size_t off = (size_t)(pos % cap);
+    const size_t first = std::min(n, cap - off);
+    applyGain(s, s->pcm.data.data() + off, first, s->ringBits);
+    if (n > first) applyGain(s, s->pcm.data.data(), n - first, s->ringBits);
+    s->gainUs += (uint64_t)(nowUs() - t0);
+}
+
+// ------------------------------------------------------------
+// Offline render sink
+// ------------------------------------------------------------
+static const size_t kWavHeaderBytes = 44;
+
+// (Re)maps the output file at newSize bytes. The file grows with the view.
+static bool renderMapFile(RenderJob* job, uint64_t newSize) {
+    if (job->view) { UnmapViewOfFile(job->view); job->view = nullptr; }
+    if (job->mapping) { CloseHandle(job->mapping); job->mapping = nullptr; }
+    job->mapping = CreateFileMappingW(job->file, nullptr, PAGE_READWRITE,
+        (DWORD)(newSize >> 32), (DWORD)newSize, nullptr);
+    if (!job->mapping) return false;
+    job->view = static_cast<uint8_t*>(MapViewOfFile(job->mapping, FILE_MAP_WRITE, 0, 0, (SIZE_T)newSize));
+    if (!job->view) return false;
+    job->mapSize = newSize;
+    return true;
+}
+
+static bool renderOpen(RenderJob* job) {
+    if (!job->outPath) return true;
+    job->file = CreateFileW(job->outPath, GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+        CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (job->file == INVALID_HANDLE_VALUE) return false;
+    return renderMapFile(job, 1024 * 1024);
+}
+
+static void renderWrite(ELOQ_STATE* s, RenderJob* job, const uint8_t* data, size_t size) {
+    if (job->aborted) return;
+    if (!job->gotAudio) {
+        job->gotAudio = true;
+        job->firstAudioTick = GetTickCount();
+    }
+
+    if (job->cb) {
+        if (job->cb(job->user, data, (int)size) != 0) job->aborted = true;
+    } else {
+        const uint64_t need = kWavHeaderBytes + job->dataBytes + size;
+        if (need > job->mapSize) {
+            uint64_t grow = job->mapSize * 2;
+            if (grow < need) grow = need;
+            if (!renderMapFile(job, grow)) job->aborted = job->ioError = true;
+        }
+        if (!job->aborted)
+            memcpy(job->view + kWavHeaderBytes + job->dataBytes, data, size);
+    }
+
+    if (job->aborted) {
+        // Let the worker's wait loop stop the engine.
+        dbgError("render: sink aborted after %llu bytes", (unsigned long long)job->dataBytes);
+        if (s->stopEvent) SetEvent(s->stopEvent);
+        return;
+    }
+    job->dataBytes += size;
+}
+
+static inline void putLE(uint8_t* p, uint32_t v, int n) {
+    for (int i = 0; i < n; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+// Writes the WAV header, trims the file to its final length and closes it.
+static void renderClose(ELOQ_STATE* s, RenderJob* job) {
+    if (job->file == INVALID_HANDLE_VALUE) return;
+    if (job->view) {
+        const WAVEFORMATEX f = outputFormat(s);
+        uint8_t* h = job->view;
+        memcpy(h, "RIFF", 4);
+        putLE(h + 4, (uint32_t)(36 + job->dataBytes), 4);
+        memcpy(h + 8, "WAVEfmt ", 8);
+        putLE(h + 16, 16, 4);
+        putLE(h + 20, f.wFormatTag, 2);
+        putLE(h + 22, f.nChannels, 2);
+        putLE(h + 24, f.nSamplesPerSec, 4);
+        putLE(h + 28, f.nAvgBytesPerSec, 4);
+        putLE(h + 32, f.nBlockAlign, 2);
+        putLE(h + 34, f.wBitsPerSample, 2);
+        memcpy(h + 36, "data", 4);
+        putLE(h + 40, (uint32_t)job->dataBytes, 4);
+        UnmapViewOfFile(job->view);
+        job->view = nullptr;
+    }
+    if (job->mapping) { CloseHandle(job->mapping); job->mapping = nullptr; }
+    LARGE_INTEGER end;
+    end.QuadPart = (LONGLONG)(kWavHeaderBytes + job->dataBytes);
+    SetFilePointerEx(job->file, end, nullptr, FILE_BEGIN);
+    SetEndOfFile(job->file);
+    CloseHandle(job->file);
+    job->file = INVALID_HANDLE_VALUE;
+}
+
+// Hands a job back to its caller. No access to job after this.
+static void renderComplete(RenderJob* job, int result) {
+    job->result = result;
+    SetEvent(job->doneEvent);
+}
+
+// Completes every render job waiting in cmdQ as canceled and drops the
+// queue. Caller holds cmdMtx.
+static void failQueuedRendersLocked(ELOQ_STATE* s) {
+    for (Cmd& c : s->cmdQ) {
+        if (c.render) renderComplete(c.render, -6);
+    }
+    s->cmdQ.clear();
+}
+
+static void pushAudioToQueue(ELOQ_STATE* s, uint32_t gen, const uint8_t* data, size_t size);
+static void pushSonicOutput(ELOQ_STATE* s, uint32_t gen, const uint8_t* data, size_t size);
+
+// Silence trimming: cap runs of silence to maxSilenceSamples. Points *out at
+// the audio to keep (src itself, or trimBuf) and returns its size.
+static size_t trimStage(ELOQ_STATE* s, const uint8_t* src, size_t size, const uint8_t** out) {
+    *out = src;
+    if (s->maxSilenceSamples == 0 || !s->formatValid) return size;
+    const int bps = s->lastFormat.wBitsPerSample;
+    const int nch = s->lastFormat.nChannels;
+    const int frameSize = (bps / 8) * nch;
+    if (frameSize <= 0 || (bps != 8 && bps != 16)) return size;
+
+    std::vector<uint8_t>& buf = s->trimBuf;
+    if (buf.size() < size) buf.resize(size); // grows once, never shrinks
+    const size_t kept = trimSilence(src, size, buf.data(), bps, nch,
+        s->maxSilenceSamples, s->silenceSamples);
+    if (kept < size)
+        s->statTrimmedBytes.fetch_add(size - kept, std::memory_order_relaxed);
+    *out = buf.data();
+    return kept;
+}
+
+// Drains what sonic has ready into sonicBuf in the output bit depth. Float
+// output is converted here, once, from sonic's internal 16-bit samples.
+// Returns the byte count.
+static size_t sonicDrain(ELOQ_STATE* s) {
+    const int nch = s->lastFormat.nChannels;
+    const int outBits = s->outBitsApplied ? s->outBitsApplied : s->lastFormat.wBitsPerSample;
+    const int outFrame = (outBits / 8) * nch;
+    const int avail = sonicSamplesAvailable(s->sonicStream);
+    if (avail <= 0 || outFrame <= 0) return 0;
+    std::vector<uint8_t>& buf = s->sonicBuf;
+    buf.resize((size_t)avail * outFrame);
+    if (outBits == 8)
+        sonicReadUnsignedCharFromStream(s->sonicStream, buf.data(), avail);
+    else if (outBits == 32)
+        sonicReadFloatFromStream(s->sonicStream, reinterpret_cast<float*>(buf.data()), avail);
+    else
+        sonicReadShortFromStream(s->sonicStream, reinterpret_cast<short*>(buf.data()), avail);
+    s->sonicOutFrames += (uint64_t)avail;
+    return buf.size();
+}
+
+// Output frame an INDEX pushed now belongs at: everything written to sonic
+// so far, through the time-stretch (speed) and resampling (rate) ratios.
+static uint64_t sonicTargetFrame(const ELOQ_STATE* s) {
+    const double ratio = (double)sonicGetSpeed(s->sonicStream) * sonicGetRate(s->sonicStream);
+    if (ratio <= 0.0) return s->sonicOutFrames;
+    return (uint64_t)((double)s->sonicInFrames / ratio + 0.5);
+}
+
+// Sonic pass: rate boost (time-stretch without pitch change), resampling to
+// the output rate (sonic's sinc interpolator) and bit-depth conversion, all
+// in one write/read. Points *out at the result in sonicBuf and returns its
+// size, 0 while sonic is still buffering internally; when none of them is
+// active the input passes through.
+static size_t sonicStage(ELOQ_STATE* s, const uint8_t* in, size_t size, const uint8_t** out) {
+    *out = in;
+    if (!sonicActive(s)) return size;
+    const int bps = s->lastFormat.wBitsPerSample;
+    const int nch = s->lastFormat.nChannels;
+    const int frameSize = (bps / 8) * nch;
+    if (frameSize <= 0 || (bps != 8 && bps != 16)) return size;
+
+    const int64_t t0 = nowUs();
+    int numSamples = (int)(size / frameSize);
+    s->sonicInFrames += (uint64_t)numSamples;
+    if (bps == 8)
+        sonicWriteUnsignedCharToStream(s->sonicStream, in, numSamples);
+    else
+        sonicWriteShortToStream(s->sonicStream, reinterpret_cast<const short*>(in), numSamples);
+
+    const size_t outSize = sonicDrain(s);
+    if (outSize > 0) *out = s->sonicBuf.data();
+    const uint32_t us = (uint32_t)(nowUs() - t0);
+    s->statSonicBuffers.fetch_add(1, std::memory_order_relaxed);
+    s->statSonicUs.fetch_add(us, std::memory_order_relaxed);
+    if (us > s->statSonicMaxUs.load(std::memory_order_relaxed))
+        s->statSonicMaxUs.store(us, std::memory_order_relaxed);
+    return outSize;
+}
+
+// Flow control for the engine-driven producers (ECI callback, waveOut hook).
+// Holding the callback or the hooked waveOutWrite back paces the engine
+// itself, so a long say-all stays a few seconds ahead of the reader instead
+// of filling the ring. Returns on drain, cancel, stop or instance shutdown,
+// and for normal-lane speech once urgent text is waiting, so the worker
+// gets back to its wait loop and suspends the generation at once.
+static void throttleProducer(ELOQ_STATE* s, uint32_t gen) {
+    if (!s->drainEvent || s->render) return;
+    const bool preemptible = !isUrgentGen(s, gen) && s->preemptEvent;
+    if (preemptible && s->urgentPending.load(std::memory_order_relaxed) > 0) return;
+    {
+        std::lock_guard<std::mutex> g(s->outMtx);
+        if (s->highWaterBytes == 0 || s->outGen != gen ||
+            gen != s->currentGen.load(std::memory_order_relaxed) ||
+            s->pcm.size() <= s->highWaterBytes)
+            return;
+        s->throttled = true;
+        ResetEvent(s->drainEvent);
+    }
+    const DWORD start = GetTickCount();
+    const uint32_t snap = s->cancelToken.load(std::memory_order_relaxed);
+    dbg("throttle: gen=%u above high water, pausing engine", gen);
+    HANDLE waits[2] = { s->drainEvent, s->preemptEvent };
+    while (genLive(s, gen) && !s->shuttingDown.load(std::memory_order_relaxed) &&
+           s->cancelToken.load(std::memory_order_relaxed) == snap) {
+        if (preemptible && s->urgentPending.load(std::memory_order_relaxed) > 0) break;
+        if (WaitForMultipleObjects(preemptible ? 2 : 1, waits, FALSE, 50) == WAIT_OBJECT_0) break;
+    }
+    {
+        std::lock_guard<std::mutex> g(s->outMtx);
+        s->throttled = false;
+    }
+    const DWORD waited = GetTickCount() - start;
+    s->throttleMs.fetch_add(waited, std::memory_order_relaxed);
+    dbg("throttle: resumed after %lu ms", waited);
+}
+
+// Warm-up output: runs the trim and sonic stages so their buffers are
+// allocated and paged in, then drops the result.
+static void warmPipeline(ELOQ_STATE* s, const void* data, size_t size) {
+    const uint8_t* out = nullptr;
+    size_t outSize = trimStage(s, static_cast<const uint8_t*>(data), size, &out);
+    if (outSize > 0) sonicStage(s, out, outSize, &out);
+}
+
+static void enqueueAudioFromHook(ELOQ_STATE* s, uint32_t gen, const void* data, size_t size) {
+    if (!s || !data || size == 0) return;
+    if (s->warming) {
+        warmPipeline(s, data, size);
+        return;
+    }
+    // Preempted by a stop: skip trimming and sonic work for dead audio.
+    if (!genLive(s, gen)) {
+        s->statDroppedBuffers.fetch_add(1, std::memory_order_relaxed);
+        s->statDroppedBytes.fetch_add(size, std::memory_order_relaxed);
+        return;
+    }
+    s->utterAudioBytes.fetch_add((uint32_t)size, std::memory_order_relaxed);
+
+    const uint8_t* out = nullptr;
+    size_t outSize = trimStage(s, static_cast<const uint8_t*>(data), size, &out);
+    if (outSize == 0) return;
+    outSize = sonicStage(s, out, outSize, &out);
+    if (outSize == 0) return;
+
+    pushSonicOutput(s, gen, out, outSize);
+    throttleProducer(s, gen);
+}
+
+static void pushAudioToQueue(ELOQ_STATE* s, uint32_t gen, const uint8_t* data, size_t size) {
+    if (!data || size == 0) return;
+
+    if (s->capturing && genLive(s, gen)) {
+        // Long output is not worth caching; give up on it.
+        const size_t limit = (size_t)s->cacheMaxBytes.load(std::memory_order_relaxed) / 4;
+        if (s->capturePcm.size() + size > limit) s->capturing = false;
+        else s->capturePcm.insert(s->capturePcm.end(), data, data + size);
+    }
+
+    if (s->render) {
+        if (gen != 0 && gen == s->sideGen.load(std::memory_order_relaxed))
+            renderWrite(s, s->render, data, size);
+        return;
+    }
+
+    // Phase 1: gate on generation and reserve space (dropping oldest audio
+    // if full). Phase 2: copy outside the lock into the reserved span, which
+    // the consumer never touches. Phase 3: publish if still current.
+    uint64_t pos = 0;
+    {
+        std::lock_guard<std::mutex> g(s->outMtx);
+        const uint32_t curGen = s->currentGen.load(std::memory_order_relaxed);
+        if (curGen == 0 || gen != curGen) {
+            // Lookahead output waits in the stage, capped like the ring.
+            if (s->staged && gen == s->sideGen.load(std::memory_order_relaxed)) {
+                if (s->stagePcm.size() + size <= s->maxBufferedBytes) {
+                    s->stagePcm.insert(s->stagePcm.end(), data, data + size);
+                    s->stageBits = outputFormat(s).wBitsPerSample;
+                } else {
+                    s->statOverrunBytes.fetch_add(size, std::memory_order_relaxed);
+                }
+            } else {
+                s->statDroppedBuffers.fetch_add(1, std::memory_order_relaxed);
+                s->statDroppedBytes.fetch_add(size, std::memory_order_relaxed);
+            }
+            return;
+        }
+        if (s->outGen != gen) {
+            clearOutputQueueLocked(s);
+            s->outGen = gen;
+        }
+        s->ringBits = outputFormat(s).wBitsPerSample;
+
+        // A chunk larger than the whole ring keeps only its newest bytes.
+        const size_t cap = s->pcm.capacity();
+        if (cap == 0) return;
+        if (size > cap) {
+            s->statOverrunBytes.fetch_add(size - cap, std::memory_order_relaxed);
+            data += size - cap;
+            size = cap;
+        }
+        // Drop oldest audio if full.
+        const size_t space = s->pcm.space();
+        if (size > space) {
+            s->pcm.readPos += size - space;
+            s->statOverrunBytes.fetch_add(size - space, std::memory_order_relaxed);
+        }
+        pos = s->pcm.writePos;
+    }
+
+    s->pcm.copyIn(pos, data, size);
+
+    std::lock_guard<std::mutex> g(s->outMtx);
+    const uint32_t curGen = s->currentGen.load(std::memory_order_relaxed);
+    if (curGen == 0 || gen != curGen || s->outGen != gen || s->pcm.writePos != pos) return;
+    s->pcm.writePos = pos + size;
+    if (s->dataEvent) SetEvent(s->dataEvent);
+
+    const uint32_t queued = (uint32_t)s->pcm.size();
+    if (queued > s->statQueuedPeak.load(std::memory_order_relaxed))
+        s->statQueuedPeak.store(queued, std::memory_order_relaxed);
+    if (s->speakRequestUs.load(std::memory_order_relaxed) != 0) {
+        const int64_t req = s->speakRequestUs.exchange(0, std::memory_order_relaxed);
+        if (req != 0) s->firstAudioLatency.add(nowUs() - req);
+    }
+}
+
+static void publishMarker(ELOQ_STATE* s, int type, int value, uint32_t gen) {
+    if (s->capturing && type == ELOQ_ITEM_INDEX && genLive(s, gen)) {
+        StreamMarker m;
+        m.type = type;
+        m.value = value;
+        m.bytePos = s->capturePcm.size();
+        s->captureMarkers.push_back(m);
+    }
+    if (s->render) {
+        if (type == ELOQ_ITEM_INDEX) s->render->indexCount++;
+        return;
+    }
+
+    std::lock_guard<std::mutex> g(s->outMtx);
+    const uint32_t curGen = s->currentGen.load(std::memory_order_relaxed);
+    if (curGen == 0 || gen != curGen) {
+        if (s->staged && gen == s->sideGen.load(std::memory_order_relaxed)) {
+            StreamMarker m;
+            m.type = type;
+            m.value = value;
+            m.bytePos = s->stagePcm.size();
+            m.frame = frameCount(s, m.bytePos);
+            s->stageMarkers.push_back(m);
+        } else {
+            s->statDroppedMarkers.fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
+    }
+    if (s->outGen != gen) {
+        clearOutputQueueLocked(s);
+        s->outGen = gen;
+    }
+    StreamMarker m;
+    m.type = type;
+    m.value = value;
+    m.bytePos = s->pcm.writePos;
+    m.frame = frameCount(s, m.bytePos - s->outBase);
+    s->markers.push(m);
+    if (s->dataEvent) SetEvent(s->dataEvent);
+    if (s->markers.size() > s->statMarkersPeak.load(std::memory_order_relaxed))
+        s->statMarkersPeak.store((uint32_t)s->markers.size(), std::memory_order_relaxed);
+}
+
+// Publishes the INDEX markers still held for sonic, at the current position.
+static void flushSonicMarkers(ELOQ_STATE* s, uint32_t gen) {
+    for (const StreamMarker& m : s->sonicMarkers) publishMarker(s, m.type, m.value, gen);
+    s->sonicMarkers.clear();
+}
+
+// The engine reports an index once the audio before it has been handed
+// over, but sonic may still hold part of that audio. Such an INDEX waits in
+// sonicMarkers until the output reaches its frame; pushSonicOutput places it
+// there. Any other marker first flushes the held ones to keep the order.
+static void pushMarker(ELOQ_STATE* s, int type, int value, uint32_t gen) {
+    if (type == ELOQ_ITEM_INDEX && !s->render && sonicActive(s)) {
+        const uint64_t target = sonicTargetFrame(s);
+        if (target > s->sonicOutFrames || !s->sonicMarkers.empty()) {
+            StreamMarker m;
+            m.type = type;
+            m.value = value;
+            m.bytePos = std::max(target, s->sonicOutFrames);
+            s->sonicMarkers.push_back(m);
+            return;
+        }
+    } else if (!s->sonicMarkers.empty()) {
+        flushSonicMarkers(s, gen);
+    }
+    publishMarker(s, type, value, gen);
+}
+
+// Pushes a block just drained from sonic (the last size bytes of
+// sonicOutFrames), splitting it at the frames of held INDEX markers.
+static void pushSonicOutput(ELOQ_STATE* s, uint32_t gen, const uint8_t* data, size_t size) {
+    const size_t fb = outputFormat(s).nBlockAlign;
+    if (s->sonicMarkers.empty() || fb == 0) {
+        pushAudioToQueue(s, gen, data, size);
+        return;
+    }
+    const uint64_t end = s->sonicOutFrames;
+    const uint64_t start = end - std::min<uint64_t>(end, size / fb);
+    size_t done = 0;
+    size_t i = 0;
+    for (; i < s->sonicMarkers.size() && s->sonicMarkers[i].bytePos <= end; i++) {
+        const StreamMarker& m = s->sonicMarkers[i];
+        const size_t at = (size_t)(std::max(m.bytePos, start) - start) * fb;
+        if (at > done) {
+            pushAudioToQueue(s, gen, data + done, at - done);
+            done = at;
+        }
+        publishMarker(s, m.type, m.value, gen);
+    }
+    s->sonicMarkers.erase(s->sonicMarkers.begin(), s->sonicMarkers.begin() + i);
+    if (done < size) pushAudioToQueue(s, gen, data + done, size - done);
+}
+
+// ------------------------------------------------------------
+// Text chunking
+// ------------------------------------------------------------
+// Chunk boundaries are marked with engine indexes in a reserved range that
+// the callback consumes instead of forwarding to the client.
+static const int kChunkIndexBase = 0xF000;
+static const int kChunkIndexMask = 0x07FF;
+
+static inline bool isTextSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Split text into pieces of at most maxChunk bytes, preferring to cut after
+// a sentence end, then after a clause, then at whitespace. Cut points are
+// searched in the back three quarters of the window so chunks stay large.
+// Every delimiter considered is below 0x40 and so can never be a DBCS trail
+// byte; only the hard-cut fallback has to respect lead bytes.
+static void splitTextChunks(const std::string& text, size_t maxChunk,
+                            std::vector<std::string>& out) {
+    out.clear();
+    const size_t n = text.size();
+    size_t pos = 0;
+    while (n - pos > maxChunk) {
+        const size_t lo = pos + maxChunk / 4;
+        const size_t hi = pos + maxChunk; // exclusive: chunk is [pos, cut)
+        size_t sentence = 0, clause = 0, space = 0;
+        for (size_t i = hi; i > lo; --i) {
+            // text[i - 1] is the last byte kept in the chunk.
+            const char c = text[i - 1];
+            const char next = text[i];
+            if (isTextSpace(next) && (c == '.' || c == '!' || c == '?')) {
+                sentence = i;
+                break;
+            }
+            if (!clause && isTextSpace(next) && (c == ',' || c == ';' || c == ':'))
+                clause = i;
+            if (!space && isTextSpace(c))
+                space = i;
+        }
+        size_t cut = sentence ? sentence : clause ? clause : space;
+        if (!cut) {
+            // No break opportunity: hard cut, but never between a DBCS lead
+            // byte and its trail byte.
+            cut = pos;
+            while (cut < hi) {
+                const size_t step = IsDBCSLeadByte((BYTE)text[cut]) ? 2 : 1;
+                if (cut + step > hi) break;
+                cut += step;
+            }
+            if (cut == pos) cut = hi;
+        }
+        out.emplace_back(text, pos, cut - pos);
+        pos = cut;
+        while (pos < n && isTextSpace(text[pos])) ++pos;
+    }
+    if (pos < n) out.emplace_back(text, pos, n - pos);
+}
+
+// ------------------------------------------------------------
+// Text rules (eloq_load_rules)
+// ------------------------------------------------------------
+// A rules file holds one substitution per line:
+//   <pattern> TAB <replacement> [TAB <flags>]
+// A pattern is literal text, or a regex between slashes (/.../) with
+// concatenation, | and ( ), [...] classes with ranges and ^, ., \d \w \s
+// \D \W \S, \t \n \r \xHH and the quantifiers ? * +; \b may open or close
+// it. Flags (space or comma separated): i = ASCII case-insensitive, w =
+// whole word (\b at both ends), voice=<id> = only while that 3.3 language
+// is selected. In the replacement $0 is the matched text, $$ a dollar, \t
+// a tab and \\ a backslash. Lines starting with # are comments.
+//
+// All rules compile into one DFA over byte classes, anchored at the scan
+// position. The worker makes a single pass over the MBCS text: where a byte
+// can start a match the DFA runs as far as it goes and the longest accepted
+// match wins (the earlier line on a tie); every other byte goes through the
+// character map. Bytes >= 0x80 count as word characters. A DBCS lead byte
+// and its trail byte are one character: matches start and end, and \b is
+// tested, only between characters, and the pair is copied through as is.
+struct TextRule {
+    std::vector<std::string> pieces; // replacement, split at each $0
+    bool boundaryStart = false;
+    bool boundaryEnd = false;
+    int voice = 0; // 0 = any
+};
+
+struct RuleSet {
+    std::vector<TextRule> rules;
+    uint8_t byteClass[256] = {};
+    int numClasses = 1;
+    std::vector<uint16_t> next; // [state * numClasses + class]; 0 = dead, 1 = start
+    std::vector<std::vector<uint16_t>> accepts; // rule indexes per state, ascending
+    bool firstByte[256] = {};
+};
+
+static const size_t kMaxRuleDfaStates = 65535;
+static const size_t kMaxRules = 65535;
+
+static inline bool isWordByte(uint8_t c) {
+    return c >= 0x80 || c == '_' || (c >= '0' && c <= '9') ||
+        ((c | 0x20) >= 'a' && (c | 0x20) <= 'z');
+}
+
+// Thompson NFA under construction. A state has either one byte-set edge
+// (set >= 0, to out) or any number of epsilon edges; fragment ends are
+// epsilon states that get linked onward.
+struct RuleNfa {
+    struct State {
+        int set = -1;
+        int out = -1;
+        std::vector<int> eps;
+        int accept = -1;
+    };
+    struct Frag {
+        int start;
+        int end;
+    };
+    std::vector<State> states;
+    std::vector<std::bitset<256>> sets;
+
+    int add() {
+        states.emplace_back();
+        return (int)states.size() - 1;
+    }
+    void link(int from, int to) { states[from].eps.push_back(to); }
+    Frag empty() {
+        const int s = add(), e = add();
+        link(s, e);
+        return { s, e };
+    }
+    Frag edge(const std::bitset<256>& b) {
+        const int s = add(), e = add();
+        states[s].set = (int)sets.size();
+        states[s].out = e;
+        sets.push_back(b);
+        return { s, e };
+    }
+};
+
+// Recursive-descent regex parser emitting into a RuleNfa.
+struct RuleParser {
+    RuleNfa& nfa;
+    const std::string& p;
+    bool icase;
+    size_t pos = 0;
+    bool ok = true;
+
+    RuleParser(RuleNfa& n, const std::string& pattern, bool ci) : nfa(n), p(pattern), icase(ci) {}
+
+    bool more() const { return pos < p.size(); }
+
+    void addByte(std::bitset<256>& b, unsigned c) const {
+        b.set(c);
+        if (icase && c < 0x80 && ((c | 0x20) >= 'a' && (c | 0x20) <= 'z')) b.set(c ^ 0x20);
+    }
+
+    // \d \w \s and their negations.
+    static bool classEscape(char c, std::bitset<256>& b) {
+        std::bitset<256> t;
+        switch (c) {
+        case 'd': case 'D':
+            for (unsigned x = '0'; x <= '9'; x++) t.set(x);
+            break;
+        case 'w': case 'W':
+            for (unsigned x = 0; x < 256; x++) if (isWordByte((uint8_t)x)) t.set(x);
+            break;
+        case 's': case 'S':
+            for (unsigned x : { ' ', '\t', '\r', '\n', '\f', '\v' }) t.set(x);
+            break;
+        default:
+            return false;
+        }
+        if (c >= 'A' && c <= 'Z') t.flip();
+        b |= t;
+        return true;
+    }
+
+    // Byte value of the escape after a backslash, -1 if invalid here.
+    int byteEscape(char c) {
+        switch (c) {
+        case 't': return '\t';
+        case 'n': return '\n';
+        case 'r': return '\r';
+        case 'x': {
+            if (pos + 2 > p.size()) return -1;
+            int v = 0;
+            for (int k = 0; k < 2; k++) {
+                const char h = p[pos++];
+                v <<= 4;
+                if (h >= '0' && h <= '9') v |= h - '0';
+                else if ((h | 0x20) >= 'a' && (h | 0x20) <= 'f') v |= (h | 0x20) - 'a' + 10;
+                else return -1;
+            }
+            return v;
+        }
+        case 'b': return -1; // boundaries only at the pattern edges
+        default: return (uint8_t)c;
+        }
+    }
+
+    RuleNfa::Frag alternation() {
+        RuleNfa::Frag f = concatenation();
+        while (ok && more() && p[pos] == '|') {
+            pos++;
+            const RuleNfa::Frag g = concatenation();
+            const int s = nfa.add(), e = nfa.add();
+            nfa.link(s, f.start);
+            nfa.link(s, g.start);
+            nfa.link(f.end, e);
+            nfa.link(g.end, e);
+            f = { s, e };
+        }
+        return f;
+    }
+
+    RuleNfa::Frag concatenation() {
+        RuleNfa::Frag f = nfa.empty();
+        while (ok && more() && p[pos] != '|' && p[pos] != ')') {
+            const RuleNfa::Frag g = repetition();
+            nfa.link(f.end, g.start);
+            f.end = g.end;
+        }
+        return f;
+    }
+
+    RuleNfa::Frag repetition() {
+        RuleNfa::Frag a = atom();
+        while (ok && more() && (p[pos] == '*' || p[pos] == '+' || p[pos] == '?')) {
+            const char q = p[pos++];
+            const int s = nfa.add(), e = nfa.add();
+            nfa.link(s, a.start);
+            if (q != '+') nfa.link(s, e);
+            nfa.link(a.end, e);
+            if (q != '?') nfa.link(a.end, a.start);
+            a = { s, e };
+        }
+        return a;
+    }
+
+    RuleNfa::Frag atom() {
+        const char c = p[pos++];
+        std::bitset<256> b;
+        switch (c) {
+        case '(': {
+            const RuleNfa::Frag f = alternation();
+            if (!more() || p[pos] != ')') ok = false;
+            else pos++;
+            return f;
+        }
+        case '*': case '+': case '?': case ')':
+            ok = false;
+            return nfa.empty();
+        case '.':
+            b.set();
+            return nfa.edge(b);
+        case '[':
+            bracketClass(b);
+            return nfa.edge(b);
+        case '\\': {
+            if (!more()) {
+                ok = false;
+                return nfa.empty();
+            }
+            const char e = p[pos++];
+            if (!classEscape(e, b)) {
+                const int v = byteEscape(e);
+                if (v < 0) {
+                    ok = false;
+                    return nfa.empty();
+                }
+                addByte(b, (unsigned)v);
+            }
+            return nfa.edge(b);
+        }
+        default:
+            addByte(b, (uint8_t)c);
+            return nfa.edge(b);
+        }
+    }
+
+    // [...] after the opening bracket; a leading ] is literal.
+    void bracketClass(std::bitset<256>& b) {
+        const bool negate = more() && p[pos] == '^';
+        if (negate) pos++;
+        bool first = true;
+        while (ok && more() && (p[pos] != ']' || first)) {
+            first = false;
+            int lo = (uint8_t)p[pos++];
+            if (lo == '\\') {
+                if (!more()) break;
+                const char e = p[pos++];
+                if (classEscape(e, b)) continue;
+                lo = byteEscape(e);
+            }
+            int hi = lo;
+            if (lo >= 0 && pos + 1 < p.size() && p[pos] == '-' && p[pos + 1] != ']') {
+                pos++;
+                hi = (uint8_t)p[pos++];
+                if (hi == '\\') hi = more() ? byteEscape(p[pos++]) : -1;
+            }
+            if (lo < 0 || hi < lo) {
+                ok = false;
+                return;
+            }
+            for (int x = lo; x <= hi; x++) addByte(b, (unsigned)x);
+        }
+        if (!ok || !more()) {
+            ok = false;
+            return;
+        }
+        pos++;
+        if (negate) b.flip();
+    }
+};
+
+static std::vector<std::string> splitTabs(const std::string& line) {
+    std::vector<std::string> out;
+    size_t start = 0;
+    while (true) {
+        const size_t tab = line.find('\t', start);
+        out.push_back(line.substr(start, tab == std::string::npos ? std::string::npos : tab - start));
+        if (tab == std::string::npos) return out;
+        start = tab + 1;
+    }
+}
+
+// Adds one rules-file line to the NFA (hung off start) and the rule table.
+// Returns false on a syntax error.
+static bool parseRuleLine(const std::string& line, RuleNfa& nfa, int start, RuleSet& rs) {
+    const std::vector<std::string> f = splitTabs(line);
+    if (f.size() < 2 || f.size() > 3 || f[0].empty()) return false;
+
+    TextRule rule;
+    bool icase = false;
+    if (f.size() == 3) {
+        size_t i = 0;
+        const std::string& flags = f[2];
+        while (i < flags.size()) {
+            const size_t end = flags.find_first_of(" ,", i);
+            const std::string tok = flags.substr(i, end == std::string::npos ? std::string::npos : end - i);
+            i = (end == std::string::npos) ? flags.size() : end + 1;
+            if (tok.empty()) continue;
+            if (tok == "i") icase = true;
+            else if (tok == "w") rule.boundaryStart = rule.boundaryEnd = true;
+            else if (tok.compare(0, 6, "voice=") == 0 && tok.size() > 6) rule.voice = atoi(tok.c_str() + 6);
+            else return false;
+        }
+    }
+
+    const std::string& pat = f[0];
+    RuleNfa::Frag frag;
+    if (pat.size() >= 2 && pat.front() == '/' && pat.back() == '/') {
+        std::string body = pat.substr(1, pat.size() - 2);
+        if (body.compare(0, 2, "\\b") == 0) {
+            rule.boundaryStart = true;
+            body.erase(0, 2);
+        }
+        if (body.size() >= 2 && body.compare(body.size() - 2, 2, "\\b") == 0) {
+            size_t slashes = 0;
+            for (size_t k = body.size() - 1; k-- > 0 && body[k] == '\\';) slashes++;
+            if (slashes % 2 == 1) {
+                rule.boundaryEnd = true;
+                body.erase(body.size() - 2);
+            }
+        }
+        if (body.empty()) return false;
+        RuleParser parser(nfa, body, icase);
+        frag = parser.alternation();
+        if (!parser.ok || parser.pos != body.size()) return false;
+    } else {
+        RuleParser lit(nfa, pat, icase);
+        frag = nfa.empty();
+        for (char c : pat) {
+            std::bitset<256> b;
+            lit.addByte(b, (uint8_t)c);
+            const RuleNfa::Frag g = nfa.edge(b);
+            nfa.link(frag.end, g.start);
+            frag.end = g.end;
+        }
+    }
+
+    const int accept = nfa.add();
+    nfa.states[accept].accept = (int)rs.rules.size();
+    nfa.link(frag.end, accept);
+    nfa.link(start, frag.start);
+
+    const std::string& repl = f[1];
+    rule.pieces.emplace_back();
+    for (size_t i = 0; i < repl.size(); i++) {
+        const char c = repl[i];
+        const char n = (i + 1 < repl.size()) ? repl[i + 1] : 0;
+        if (c == '$' && n == '0') { rule.pieces.emplace_back(); i++; }
+        else if (c == '$' && n == '$') { rule.pieces.back() += '$'; i++; }
+        else if (c == '\\' && n == 't') { rule.pieces.back() += '\t'; i++; }
+        else if (c == '\\' && n == '\\') { rule.pieces.back() += '\\'; i++; }
+        else rule.pieces.back() += c;
+    }
+    rs.rules.push_back(std::move(rule));
+    return true;
+}
+
+// Subset construction from the NFA's start state. Fails on a pattern that
+// matches the empty string or past kMaxRuleDfaStates.
+static bool buildRuleDfa(const RuleNfa& nfa, int start, RuleSet& rs) {
+    // Byte classes: bytes every edge treats alike share a column.
+    int cls[256] = {};
+    int numCls = 1;
+    for (const std::bitset<256>& set : nfa.sets) {
+        std::vector<int> remap((size_t)numCls * 2, -1);
+        int n = 0;
+        for (int b = 0; b < 256; b++) {
+            int& slot = remap[(size_t)cls[b] * 2 + (set[b] ? 1 : 0)];
+            if (slot < 0) slot = n++;
+            cls[b] = slot;
+        }
+        numCls = n;
+    }
+    int rep[256];
+    for (int b = 255; b >= 0; b--) rep[cls[b]] = b;
+    rs.numClasses = numCls;
+    for (int b = 0; b < 256; b++) rs.byteClass[b] = (uint8_t)cls[b];
+
+    std::vector<uint32_t> mark(nfa.states.size(), 0);
+    uint32_t stamp = 0;
+    auto closure = [&](const std::vector<int>& seed) {
+        std::vector<int> out;
+        std::vector<int> stack;
+        ++stamp;
+        for (int s : seed) {
+            if (mark[s] == stamp) continue;
+            mark[s] = stamp;
+            out.push_back(s);
+            stack.push_back(s);
+        }
+        while (!stack.empty()) {
+            const int s = stack.back();
+            stack.pop_back();
+            for (int t : nfa.states[s].eps) {
+                if (mark[t] == stamp) continue;
+                mark[t] = stamp;
+                out.push_back(t);
+                stack.push_back(t);
+            }
+        }
+        std::sort(out.begin(), out.end());
+        return out;
+    };
+
+    std::unordered_map<std::string, int> ids;
+    std::vector<std::vector<int>> dstates(1); // 0 = dead
+    rs.next.assign((size_t)numCls, 0);
+    rs.accepts.assign(1, {});
+    auto intern = [&](const std::vector<int>& seed) -> int {
+        if (seed.empty()) return 0;
+        std::vector<int> set = closure(seed);
+        std::string key(reinterpret_cast<const char*>(set.data()), set.size() * sizeof(int));
+        auto it = ids.find(key);
+        if (it != ids.end()) return it->second;
+        if (dstates.size() >= kMaxRuleDfaStates) return -1;
+        const int id = (int)dstates.size();
+        ids.emplace(std::move(key), id);
+        std::vector<uint16_t> acc;
+        for (int s : set)
+            if (nfa.states[s].accept >= 0) acc.push_back((uint16_t)nfa.states[s].accept);
+        std::sort(acc.begin(), acc.end());
+        rs.accepts.push_back(std::move(acc));
+        rs.next.resize(rs.next.size() + (size_t)numCls, 0);
+        dstates.push_back(std::move(set));
+        return id;
+    };
+
+    if (intern(std::vector<int>{ start }) != 1) return false;
+    if (!rs.accepts[1].empty()) return false; // some rule matches nothing
+    std::vector<int> move;
+    for (size_t d = 1; d < dstates.size(); d++) {
+        const std::vector<int> set = dstates[d]; // intern may grow dstates
+        for (int c = 0; c < numCls; c++) {
+            move.clear();
+            for (int s : set) {
+                const RuleNfa::State& st = nfa.states[s];
+                if (st.set >= 0 && nfa.sets[st.set][rep[c]]) move.push_back(st.out);
+            }
+            const int t = intern(move);
+            if (t < 0) return false;
+            rs.next[d * numCls + c] = (uint16_t)t;
+        }
+    }
+    for (int b = 0; b < 256; b++) rs.firstByte[b] = rs.next[(size_t)numCls + cls[b]] != 0;
+    return true;
+}
+
+// Reads and compiles a rules file. Returns the rule count, -2 if the file
+// cannot be read, -3 on a syntax error or an oversized DFA.
+static int compileRulesFile(const wchar_t* path, std::shared_ptr<const RuleSet>* out) {
+    HANDLE hFile = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) return -2;
+    const DWORD size = GetFileSize(hFile, nullptr);
+    std::string data;
+    DWORD got = 0;
+    bool readOk = size != INVALID_FILE_SIZE && size <= 16 * 1024 * 1024;
+    if (readOk) {
+        data.resize(size);
+        readOk = size == 0 || (ReadFile(hFile, &data[0], size, &got, nullptr) && got == size);
+    }
+    CloseHandle(hFile);
+    if (!readOk) return -2;
+    if (data.compare(0, 3, "\xEF\xBB\xBF") == 0) data.erase(0, 3);
+
+    auto rs = std::make_shared<RuleSet>();
+    RuleNfa nfa;
+    const int start = nfa.add();
+    size_t pos = 0;
+    int lineNo = 0;
+    while (pos < data.size()) {
+        size_t end = data.find('\n', pos);
+        if (end == std::string::npos) end = data.size();
+        std::string line = data.substr(pos, end - pos);
+        pos = end + 1;
+        lineNo++;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+        if (rs->rules.size() >= kMaxRules || !parseRuleLine(line, nfa, start, *rs)) {
+            dbgError("eloq_load_rules: bad rule on line %d", lineNo);
+            return -3;
+        }
+    }
+    if (!rs->rules.empty() && !buildRuleDfa(nfa, start, *rs)) {
+        dbgError("eloq_load_rules: rules match empty text or need more than %zu states",
+            kMaxRuleDfaStates);
+        return -3;
+    }
+    const int count = (int)rs->rules.size();
+    dbgInfo("eloq_load_rules: %d rules, %zu states, %d byte classes",
+        count, rs->accepts.size(), rs->numClasses);
+    *out = count ? std::move(rs) : nullptr;
+    return count;
+}
+
+// Bytes the engine should not see: brackets and parens are read as full
+// words ("LEFT PAREN LEFT PARENTHESIS"), so they become spaces in all modes.
+// The backtick only goes in mode 20; mode 33 uses it as the ECI inline
+// command prefix (e.g. `da0, `vv92).
+static void initCharMap(uint8_t* map, int mode) {
+    for (int c = 0; c < 256; c++) map[c] = (uint8_t)c;
+    for (char c : { '(', ')', '{', '}', '[', ']' }) map[(uint8_t)c] = ' ';
+    if (mode == ELOQ_MODE_20) map[(uint8_t)'`'] = ' ';
+}
+
+// Bytes in the character at t[i]: 2 for a DBCS lead byte with its trail.
+static inline size_t textCharBytes(const uint8_t* t, size_t i, size_t n) {
+    return (i + 1 < n && IsDBCSLeadByte(t[i])) ? 2 : 1;
+}
+
+// Appends t[from, to) through the character map, leaving double-byte
+// characters whole (a trail byte may be '[' or '`').
+static void appendMapped(const uint8_t* charMap, const uint8_t* t, size_t from, size_t to,
+    std::string& out) {
+    while (from < to) {
+        const size_t step = textCharBytes(t, from, to);
+        if (step == 2) out.append(reinterpret_cast<const char*>(t + from), 2);
+        else out += (char)charMap[t[from]];
+        from += step;
+    }
+}
+
+// The single text pass: rule substitutions where they match, the character
+// map everywhere else. voice filters voice= rules.
+static void applyTextRules(const RuleSet& rs, const uint8_t* charMap, int voice,
+    const std::string& in, std::string& out) {
+    out.clear();
+    out.reserve(in.size() + in.size() / 8);
+    const size_t n = in.size();
+    const uint8_t* t = reinterpret_cast<const uint8_t*>(in.data());
+    const int nc = rs.numClasses;
+    bool prevWord = false; // the character before i
+    size_t i = 0;
+    while (i < n) {
+        const size_t step = textCharBytes(t, i, n);
+        if (rs.firstByte[t[i]]) {
+            const bool startBoundary = !prevWord == isWordByte(t[i]);
+            int state = 1;
+            size_t bestEnd = 0;
+            bool bestWord = false;
+            const TextRule* best = nullptr;
+            size_t charStart = i, charEnd = i + step;
+            for (size_t j = i; j < n; j++) {
+                state = rs.next[(size_t)state * nc + rs.byteClass[t[j]]];
+                if (!state) break;
+                if (j + 1 != charEnd) continue; // inside a double-byte character
+                const bool endWord = isWordByte(t[charStart]);
+                for (uint16_t r : rs.accepts[state]) {
+                    const TextRule& rule = rs.rules[r];
+                    if (rule.voice && rule.voice != voice) continue;
+                    if (rule.boundaryStart && !startBoundary) continue;
+                    if (rule.boundaryEnd && j + 1 < n && endWord == isWordByte(t[j + 1])) continue;
+                    if (rule.boundaryEnd && j + 1 == n && !endWord) continue;
+                    best = &rule;
+                    bestEnd = j + 1;
+                    bestWord = endWord;
+                    break;
+                }
+                charStart = charEnd;
+                if (charEnd < n) charEnd += textCharBytes(t, charEnd, n);
+            }
+            if (best) {
+                for (size_t k = 0; k < best->pieces.size(); k++) {
+                    if (k > 0) appendMapped(charMap, t, i, bestEnd, out);
+                    out += best->pieces[k];
+                }
+                prevWord = bestWord;
+                i = bestEnd;
+                continue;
+            }
+        }
+        prevWord = isWordByte(t[i]);
+        appendMapped(charMap, t, i, i + step, out);
+        i += step;
+    }
+}
+
+// ------------------------------------------------------------
+// Dictionary manager (eloq_load_dict)
+// ------------------------------------------------------------
+// Source dictionaries (one "key<TAB>translation" per line) are parsed once
+// into a binary cache: <source>.eloqcache next to the file, or under the
+// temp directory when that is not writable. The cache stays valid while
+// the source's size and write time match its header, so later loads just
+// map it. The layout is a header, then two blob offsets (key, translation)
+// per entry, then the NUL-terminated strings. Keys are unique; the last
+// line for a key wins.
+//
+// The caller thread does all file work. The worker builds a new ECI
+// dictionary from the caches between utterances, makes it current, and
+// deletes the old one, so an utterance never sees a half-loaded dictionary.
+#define ELOQ_DICT_CACHE_MAGIC   0x43494445u // 'EDIC'
+#define ELOQ_DICT_CACHE_VERSION 1u
+
+struct DictCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceSize;
+    uint64_t sourceTime; // FILETIME of the last write
+    uint32_t entries;
+    uint32_t blobBytes;
+    uint32_t skippedLines; // source lines without a key and translation
+    uint32_t reserved;
+};
+
+// One volume's cache, mapped from disk or (if it could not be written)
+// held in memory.
+struct DictCache {
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+    const uint8_t* view = nullptr;
+    std::vector<uint8_t> owned;
+    const uint32_t* index = nullptr;
+    const char* blob = nullptr;
+    uint32_t entries = 0;
+    uint32_t skippedLines = 0;
+    std::string sourcePath; // for the eciLoadDict fallback
+
+    const char* key(uint32_t i) const { return blob + index[i * 2]; }
+    const char* translation(uint32_t i) const { return blob + index[i * 2 + 1]; }
+
+    ~DictCache() {
+        if (view) UnmapViewOfFile(view);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+    }
+};
+
+// A pending swap: the caches for ECI's main (0) and root (1) volumes.
+struct DictLoad {
+    std::shared_ptr<DictCache> vol[2];
+};
+
+// Checks a cache image against the source it claims to describe and points
+// the accessors into it.
+static bool bindDictCache(DictCache& c, const uint8_t* data, size_t size,
+    uint64_t sourceSize, uint64_t sourceTime) {
+    if (size < sizeof(DictCacheHeader)) return false;
+    DictCacheHeader h;
+    memcpy(&h, data, sizeof(h));
+    if (h.magic != ELOQ_DICT_CACHE_MAGIC || h.version != ELOQ_DICT_CACHE_VERSION ||
+        h.sourceSize != sourceSize || h.sourceTime != sourceTime)
+        return false;
+    const uint64_t indexBytes = (uint64_t)h.entries * 8;
+    if (sizeof(h) + indexBytes + h.blobBytes != size) return false;
+    if (h.entries && (h.blobBytes == 0 || data[size - 1] != 0)) return false;
+    const uint32_t* index = reinterpret_cast<const uint32_t*>(data + sizeof(h));
+    for (uint64_t i = 0; i < (uint64_t)h.entries * 2; i++)
+        if (index[i] >= h.blobBytes) return false;
+    c.index = index;
+    c.blob = reinterpret_cast<const char*>(data + sizeof(h) + indexBytes);
+    c.entries = h.entries;
+    c.skippedLines = h.skippedLines;
+    return true;
+}
+
+static std::shared_ptr<DictCache> mapDictCache(const std::string& path,
+    uint64_t sourceSize, uint64_t sourceTime) {
+    auto c = std::make_shared<DictCache>();
+    c->file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr);
+    if (c->file == INVALID_HANDLE_VALUE) return nullptr;
+    LARGE_INTEGER size = {};
+    if (!GetFileSizeEx(c->file, &size) || size.QuadPart < (LONGLONG)sizeof(DictCacheHeader) ||
+        size.QuadPart > 0x7FFFFFFF)
+        return nullptr;
+    c->mapping = CreateFileMappingW(c->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!c->mapping) return nullptr;
+    c->view = static_cast<const uint8_t*>(MapViewOfFile(c->mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!c->view) return nullptr;
+    if (!bindDictCache(*c, c->view, (size_t)size.QuadPart, sourceSize, sourceTime)) return nullptr;
+    return c;
+}
+
+// Parses a source dictionary into a cache image.
+static void buildDictCache(const std::string& src, uint64_t sourceSize, uint64_t sourceTime,
+    std::vector<uint8_t>& out) {
+    std::vector<std::pair<std::string, std::string>> entries;
+    std::unordered_map<std::string, size_t> byKey;
+    uint32_t skipped = 0;
+    size_t pos = 0;
+    while (pos < src.size()) {
+        size_t end = src.find('\n', pos);
+        if (end == std::string::npos) end = src.size();
+        size_t a = pos, b = end;
+        pos = end + 1;
+        while (b > a && (src[b - 1] == '\r' || src[b - 1] == ' ' || src[b - 1] == '\t')) b--;
+        while (a < b && src[a] == ' ') a++;
+        if (a == b) continue;
+        size_t sep = src.find('\t', a);
+        if (sep == std::string::npos || sep >= b) sep = src.find(' ', a);
+        if (sep == std::string::npos || sep >= b) {
+            skipped++;
+            continue;
+        }
+        size_t t = sep + 1;
+        while (t < b && (src[t] == ' ' || src[t] == '\t')) t++;
+        size_t k = sep;
+        while (k > a && src[k - 1] == ' ') k--;
+        std::string key = src.substr(a, k - a);
+        std::string value = src.substr(t, b - t);
+        auto it = byKey.find(key);
+        if (it != byKey.end()) {
+            entries[it->second].second = std::move(value);
+        } else {
+            byKey.emplace(key, entries.size());
+            entries.emplace_back(std::move(key), std::move(value));
+        }
+    }
+
+    DictCacheHeader h = {};
+    h.magic = ELOQ_DICT_CACHE_MAGIC;
+    h.version = ELOQ_DICT_CACHE_VERSION;
+    h.sourceSize = sourceSize;
+    h.sourceTime = sourceTime;
+    h.entries = (uint32_t)entries.size();
+    h.skippedLines = skipped;
+    std::vector<uint32_t> index;
+    index.reserve(entries.size() * 2);
+    std::string blob;
+    for (const auto& e : entries) {
+        index.push_back((uint32_t)blob.size());
+        blob.append(e.first).push_back('\0');
+        index.push_back((uint32_t)blob.size());
+        blob.append(e.second).push_back('\0');
+    }
+    h.blobBytes = (uint32_t)blob.size();
+    out.resize(sizeof(h) + index.size() * 4 + blob.size());
+    memcpy(out.data(), &h, sizeof(h));
+    if (!index.empty()) memcpy(out.data() + sizeof(h), index.data(), index.size() * 4);
+    if (!blob.empty()) memcpy(out.data() + sizeof(h) + index.size() * 4, blob.data(), blob.size());
+}
+
+// Writes via a temporary file so a reader never maps a partial cache.
+static bool writeDictCache(const std::string& path, const std::vector<uint8_t>& image) {
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%lu.%lu.tmp", GetCurrentProcessId(), GetCurrentThreadId());
+    const std::string tmp = path + suffix;
+    HANDLE f = CreateFileA(tmp.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (f == INVALID_HANDLE_VALUE) return false;
+    DWORD wrote = 0;
+    const bool ok = WriteFile(f, image.data(), (DWORD)image.size(), &wrote, nullptr) && wrote == image.size();
+    CloseHandle(f);
+    if (!ok || !MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        DeleteFileA(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Opens the cache for a source dictionary, rebuilding it when the source
+// changed. Returns null if the source cannot be read.
+static std::shared_ptr<DictCache> openDictCache(const std::string& source, bool* hit) {
+    WIN32_FILE_ATTRIBUTE_DATA attr;
+    if (!GetFileAttributesExA(source.c_str(), GetFileExInfoStandard, &attr)) return nullptr;
+    const uint64_t size = ((uint64_t)attr.nFileSizeHigh << 32) | attr.nFileSizeLow;
+    const uint64_t time = ((uint64_t)attr.ftLastWriteTime.dwHighDateTime << 32) |
+        attr.ftLastWriteTime.dwLowDateTime;
+    if (size > 256u * 1024 * 1024) return nullptr;
+
+    // Next to the source first, then the temp directory keyed by a hash
+    // of the source path (FNV-1a).
+    std::string paths[2] = { source + ".eloqcache", std::string() };
+    char tempDir[MAX_PATH];
+    const DWORD tempLen = GetTempPathA(MAX_PATH, tempDir);
+    if (tempLen > 0 && tempLen < MAX_PATH) {
+        uint32_t hash = 2166136261u;
+        for (char ch : source) hash = (hash ^ (uint8_t)ch) * 16777619u;
+        char name[40];
+        snprintf(name, sizeof(name), "eloq_dict_%08x.eloqcache", hash);
+        paths[1] = std::string(tempDir, tempLen) + name;
+    }
+
+    *hit = false;
+    for (const std::string& p : paths) {
+        if (p.empty()) continue;
+        if (auto c = mapDictCache(p, size, time)) {
+            c->sourcePath = source;
+            *hit = true;
+            return c;
+        }
+    }
+
+    HANDLE f = CreateFileA(source.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr);
+    if (f == INVALID_HANDLE_VALUE) return nullptr;
+    std::string src((size_t)size, '\0');
+    DWORD got = 0;
+    const bool readOk = size == 0 || (ReadFile(f, &src[0], (DWORD)size, &got, nullptr) && got == size);
+    CloseHandle(f);
+    if (!readOk) return nullptr;
+
+    std::vector<uint8_t> image;
+    buildDictCache(src, size, time, image);
+    for (const std::string& p : paths) {
+        if (p.empty() || !writeDictCache(p, image)) continue;
+        if (auto c = mapDictCache(p, size, time)) {
+            c->sourcePath = source;
+            return c;
+        }
+    }
+    dbgInfo("eloq_load_dict: no writable cache location for '%s', keeping it in memory", source.c_str());
+    auto c = std::make_shared<DictCache>();
+    c->owned = std::move(image);
+    bindDictCache(*c, c->owned.data(), c->owned.size(), size, time);
+    c->sourcePath = source;
+    return c;
+}
+
+// Worker, between utterances: builds a new engine dictionary from the
+// caches and swaps it in for the old one.
+static void swapDictionary(ELOQ_STATE* s, const DictLoad& load) {
+    const int64_t t0 = nowUs();
+    const int dict = s->fnNewDict(s->handle);
+    if (dict == 0) { // NULL_DICT_HAND
+        dbgError("worker: eciNewDict failed");
+        s->dictResult.store(-3, std::memory_order_relaxed);
+        return;
+    }
+    uint32_t entries[2] = {};
+    uint32_t rejected = 0;
+    for (int v = 0; v < 2; v++) {
+        const DictCache* c = load.vol[v].get();
+        if (!c) continue;
+        if (s->fnUpdateDict) {
+            for (uint32_t i = 0; i < c->entries; i++)
+                if (s->fnUpdateDict(s->handle, dict, v, c->key(i), c->translation(i)) != 0) rejected++;
+        } else {
+            s->fnLoadDict(s->handle, dict, v, c->sourcePath.c_str());
+        }
+        entries[v] = c->entries;
+    }
+    s->fnSetDict(s->handle, dict);
+    if (s->dictHandle != 0 && s->fnDeleteDict) s->fnDeleteDict(s->handle, s->dictHandle);
+    s->dictHandle = dict;
+    // Cached phrases were rendered with the old dictionary.
+    s->dictVersion.fetch_add(1, std::memory_order_relaxed);
+
+    const uint32_t us = (uint32_t)(nowUs() - t0);
+    s->dictMainEntries.store(entries[0], std::memory_order_relaxed);
+    s->dictRootEntries.store(entries[1], std::memory_order_relaxed);
+    s->dictRejected.store(rejected, std::memory_order_relaxed);
+    s->dictLoadUs.store(us, std::memory_order_relaxed);
+    s->dictLoads.fetch_add(1, std::memory_order_relaxed);
+    s->dictResult.store(0, std::memory_order_relaxed);
+    dbgInfo("worker: dictionary swapped in: main=%u root=%u rejected=%u in %u us",
+        entries[0], entries[1], rejected, us);
+}
+
+// ------------------------------------------------------------
+// ECI callback (shared by both modes, called on worker thread)
+// ------------------------------------------------------------
+static int __cdecl eciCallback(int h, int msgType, int length, void* data) {
+    // Registered with the owning instance as user data.
+    ELOQ_STATE* s = static_cast<ELOQ_STATE*>(data);
+    if (!s) { dbg("eciCallback: instance NULL"); return 2; }
+
+    const uint32_t gen = s->activeGen.load(std::memory_order_relaxed);
+    const uint32_t curGen = s->currentGen.load(std::memory_order_relaxed);
+    dbg("eciCallback: msg=%d len=%d gen=%u curGen=%u", msgType, length, gen, curGen);
+    if (!genLive(s, gen) && !s->warming) { dbg("eciCallback: gen mismatch, dropping"); return 2; }
+
+    if (s->mode == ELOQ_MODE_33 && msgType == 0) {
+        if (length > 0) {
+            // 3.3: Audio data in output buffer.
+            const size_t samples = std::min<size_t>((size_t)length, s->eciBuffer.size());
+            dbg("eciCallback: enqueueing %zu audio bytes", samples * 2);
+            enqueueAudioFromHook(s, gen, s->eciBuffer.data(), samples * 2);
+        } else {
+            // 3.3: length==0 means end of synthesis (no 0xFFFF in this mode).
+            dbg("eciCallback: DONE (msg=0, len=0)");
+            if (s->doneEvent) SetEvent(s->doneEvent);
+        }
+    }
+
+    if (msgType == 2) {
+        if (length == 0xFFFF) {
+            // End of utterance (2.0 style).
+            dbg("eciCallback: DONE (0xFFFF)");
+            if (s->doneEvent) SetEvent(s->doneEvent);
+        } else if ((length & ~kChunkIndexMask) == kChunkIndexBase) {
+            // Internal chunk boundary: the engine is about to run out of
+            // text, so let the worker feed the next chunk.
+            dbg("eciCallback: chunk boundary %d", length & kChunkIndexMask);
+            noteChunkBoundary(s, gen, length & kChunkIndexMask);
+            if (s->chunkEvent) SetEvent(s->chunkEvent);
+        } else {
+            // Index marker.
+            dbg("eciCallback: INDEX %d", length);
+            pushMarker(s, ELOQ_ITEM_INDEX, length, gen);
+        }
+    }
+
+    return 1;
+}
+
+// ------------------------------------------------------------
+// WaveOut hooks (2.0 only)
+// ------------------------------------------------------------
+static MMRESULT WINAPI hook_waveOutOpen(
+    LPHWAVEOUT phwo,
+    UINT uDeviceID,
+    LPCWAVEFORMATEX pwfx,
+    DWORD_PTR dwCallback,
+    DWORD_PTR dwInstance,
+    DWORD fdwOpen
+) {
+    ELOQ_STATE* s = g_hookTarget.load(std::memory_order_acquire);
+    // Intercept opens coming from the Eloquence modules or the worker
+    // thread. Speech.dll is loaded lazily by the engine: until it shows up,
+    // a foreign caller costs one GetModuleHandleW; once its range is cached
+    // (until the engine unloads) the check is the table alone.
+    void* ra = _ReturnAddress();
+    bool fromEloq = s && (isCallerFromEloquence(ra) || GetCurrentThreadId() == s->workerThreadId);
+    if (s && !fromEloq && !g_speechRangeKnown.load(std::memory_order_relaxed)) {
+        if (HMODULE speech = GetModuleHandleW(L"SPEECH.DLL")) {
+            addModuleRange(speech);
+            g_speechRangeKnown.store(true, std::memory_order_relaxed);
+            fromEloq = isCallerFromEloquence(ra);
+        }
+    }
+    dbg("hook_waveOutOpen: fromEloq=%d ra=%p", fromEloq, ra);
+    if (!fromEloq) {
+        return g_waveOutOpenOrig ? g_waveOutOpenOrig(phwo, uDeviceID, pwfx, dwCallback, dwInstance, fdwOpen)
+            : MMSYSERR_ERROR;
+    }
+
+    HWAVEOUT fakeHandle = reinterpret_cast<HWAVEOUT>(s);
+    if (phwo) *phwo = fakeHandle;
+    s->eloqWaveHandle = fakeHandle;
+
+    if (pwfx) {
+        s->lastFormat = *pwfx;
+        s->formatValid = true;
+
+        uint64_t bps = (uint64_t)pwfx->nAvgBytesPerSec;
+        if (!bps && pwfx->nSamplesPerSec && pwfx->nBlockAlign)
+            bps = (uint64_t)pwfx->nSamplesPerSec * (uint64_t)pwfx->nBlockAlign;
+        if (!bps) bps = 22050;
+        s->bytesPerSec.store(bps, std::memory_order_relaxed);
+
+        // Silence trimming: cap at 60 ms of silence.
+        if (s->maxSilenceSamples == 0 && pwfx->nSamplesPerSec > 0)
+            s->maxSilenceSamples = pwfx->nSamplesPerSec * 60 / 1000;
+    }
+
+    s->callbackType = fdwOpen;
+    s->callbackTarget = dwCallback;
+    s->callbackInstance = dwInstance;
+
+    signalWaveOutMessage(s, WOM_OPEN, nullptr);
+    return MMSYSERR_NOERROR;
+}
+
+static MMRESULT WINAPI hook_waveOutPrepareHeader(HWAVEOUT hwo, LPWAVEHDR pwh, UINT cbwh) {
+    ELOQ_STATE* s = g_hookTarget.load(std::memory_order_acquire);
+    if (!s || hwo != s->eloqWaveHandle) {
+        return g_waveOutPrepareHeaderOrig ? g_waveOutPrepareHeaderOrig(hwo, pwh, cbwh) : MMSYSERR_ERROR;
+    }
+    if (pwh) pwh->dwFlags |= WHDR_PREPARED;
+    return MMSYSERR_NOERROR;
+}
+
+static MMRESULT WINAPI hook_waveOutUnprepareHeader(HWAVEOUT hwo, LPWAVEHDR pwh, UINT cbwh) {
+    ELOQ_STATE* s = g_hookTarget.load(std::memory_order_acquire);
+    if (!s || hwo != s->eloqWaveHandle) {
+        return g_waveOutUnprepareHeaderOrig ? g_waveOutUnprepareHeaderOrig(hwo, pwh, cbwh) : MMSYSERR_ERROR;
+    }
+    if (pwh) pwh->dwFlags &= ~WHDR_PREPARED;
+    return MMSYSERR_NOERROR;
 }
 
 static MMRESULT WINAPI hook_waveOutWrite(HWAVEOUT hwo, LPWAVEHDR pwh, UINT cbwh) {
-    ELOQ_STATE* s = g_state;
-    bool fromEloq = s && s->mode == ELOQ_MODE_20 && hwo == s->eloqWaveHandle;
+    ELOQ_STATE* s = g_hookTarget.load(std::memory_order_acquire);
+    bool fromEloq = s && hwo == s->eloqWaveHandle;
     if (!fromEloq) {
         return g_waveOutWriteOrig ? g_waveOutWriteOrig(hwo, pwh, cbwh) : MMSYSERR_ERROR;
     }
@@ -576,12 +3103,12 @@ static MMRESULT WINAPI hook_waveOutWrite(HWAVEOUT hwo, LPWAVEHDR pwh, UINT cbwh)
 
     const uint32_t gen = s->activeGen.load(std::memory_order_relaxed);
     const uint32_t curGen = s->currentGen.load(std::memory_order_relaxed);
-    const bool capturing = (gen != 0 && gen == curGen);
+    const bool capturing = genLive(s, gen);
 
     dbg("hook_waveOutWrite: %lu bytes, capturing=%d gen=%u curGen=%u",
         pwh->dwBufferLength, capturing, gen, curGen);
 
-    if (capturing && pwh->lpData && pwh->dwBufferLength > 0) {
+    if ((capturing || s->warming) && pwh->lpData && pwh->dwBufferLength > 0) {
         enqueueAudioFromHook(s, gen, pwh->lpData, (size_t)pwh->dwBufferLength);
     }
 
@@ -591,8 +3118,8 @@ static MMRESULT WINAPI hook_waveOutWrite(HWAVEOUT hwo, LPWAVEHDR pwh, UINT cbwh)
 }
 
 static MMRESULT WINAPI hook_waveOutReset(HWAVEOUT hwo) {
-    ELOQ_STATE* s = g_state;
-    if (!s || s->mode != ELOQ_MODE_20 || hwo != s->eloqWaveHandle) {
+    ELOQ_STATE* s = g_hookTarget.load(std::memory_order_acquire);
+    if (!s || hwo != s->eloqWaveHandle) {
         return g_waveOutResetOrig ? g_waveOutResetOrig(hwo) : MMSYSERR_ERROR;
     }
     dbg("hook_waveOutReset: signaling doneEvent");
@@ -602,8 +3129,8 @@ static MMRESULT WINAPI hook_waveOutReset(HWAVEOUT hwo) {
 }
 
 static MMRESULT WINAPI hook_waveOutClose(HWAVEOUT hwo) {
-    ELOQ_STATE* s = g_state;
-    if (!s || s->mode != ELOQ_MODE_20 || hwo != s->eloqWaveHandle) {
+    ELOQ_STATE* s = g_hookTarget.load(std::memory_order_acquire);
+    if (!s || hwo != s->eloqWaveHandle) {
         return g_waveOutCloseOrig ? g_waveOutCloseOrig(hwo) : MMSYSERR_ERROR;
     }
     dbg("hook_waveOutClose: signaling doneEvent");
@@ -645,15 +3172,83 @@ static bool ensureHooksInstalled() {
         return false;
     }
 
-    MH_EnableHook(MH_ALL_HOOKS);
-    return true;
-}
+    // Hooks stay disabled until a 2.0 instance arms them.
+    return true;
+}
+
+// Routes the hooks to s and enables them; other audio in the process runs
+// through the original waveOut functions untouched while disarmed.
+static bool armHooks(ELOQ_STATE* s) {
+    if (!ensureHooksInstalled()) return false;
+    g_hookTarget.store(s, std::memory_order_release);
+    MH_STATUS st = MH_EnableHook(MH_ALL_HOOKS);
+    return st == MH_OK || st == MH_ERROR_ENABLED;
+}
+
+static void disarmHooks(ELOQ_STATE* s) {
+    if (g_hookTarget.load(std::memory_order_relaxed) != s) return;
+    MH_DisableHook(MH_ALL_HOOKS);
+    g_hookTarget.store(nullptr, std::memory_order_release);
+    // The hooked engine is the only one (2.0 is not instanceable) and its
+    // worker has unloaded it.
+    clearModuleRanges();
+}
+
+// ------------------------------------------------------------
+// ELOQ.CFG path patching (3.3 only)
+// ------------------------------------------------------------
+// Offset of the first data path in ELOQ.CFG.
+static const size_t kCfgPathOffset = 2119;
+
+// Directory whose ELOQ.CFG was verified or patched by this process.
+static std::mutex g_cfgMtx;
+static std::wstring g_cfgCheckedDir;
+
+// Cheap check: read just the path at kCfgPathOffset and compare it with
+// dir (MBCS, trailing backslash). True when no rewrite is needed, including
+// when the file is missing or too short to patch.
+static bool eloqCfgMatches(const std::wstring& cfgPath, const char* mbcsDir, size_t mbcsDirLen) {
+    HANDLE hFile = CreateFileW(cfgPath.c_str(), GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, 0, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) return true;
+
+    bool match = true;
+    char line[MAX_PATH * 2] = {};
+    DWORD bytesRead = 0;
+    const DWORD fileSize = GetFileSize(hFile, nullptr);
+    if (fileSize != INVALID_FILE_SIZE && fileSize >= 2200 &&
+        SetFilePointer(hFile, (LONG)kCfgPathOffset, nullptr, FILE_BEGIN) == kCfgPathOffset &&
+        ReadFile(hFile, line, (DWORD)(sizeof(line) - 1), &bytesRead, nullptr)) {
+        match = bytesRead >= mbcsDirLen && _strnicmp(line, mbcsDir, mbcsDirLen) == 0;
+    }
+    CloseHandle(hFile);
+    return match;
+}
+
+static void patchEloqCfg(const std::wstring& dir) {
+    std::lock_guard<std::mutex> lk(g_cfgMtx);
+    if (g_cfgCheckedDir == dir) return;
+
+    std::wstring cfgPath = dir + L"\\ELOQ.CFG";
+
+    // Convert dir to MBCS for comparison/replacement.
+    char mbcsDir[MAX_PATH * 2] = {};
+    WideCharToMultiByte(CP_ACP, 0, dir.c_str(), -1, mbcsDir, sizeof(mbcsDir), nullptr, nullptr);
+    size_t mbcsDirLen = strlen(mbcsDir);
+    // Ensure trailing backslash.
+    if (mbcsDirLen > 0 && mbcsDir[mbcsDirLen - 1] != '\\') {
+        mbcsDir[mbcsDirLen] = '\\';
+        mbcsDir[mbcsDirLen + 1] = '\0';
+        mbcsDirLen++;
+    }
+
+    // Usual case: the path is already right; skip the full read/rewrite.
+    if (eloqCfgMatches(cfgPath, mbcsDir, mbcsDirLen)) {
+        g_cfgCheckedDir = dir;
+        return;
+    }
+    dbgInfo("patchEloqCfg: rewriting data paths in ELOQ.CFG");
 
-// ------------------------------------------------------------
-// ELOQ.CFG path patching (3.3 only)
-// ------------------------------------------------------------
-static void patchEloqCfg(const std::wstring& dir) {
-    std::wstring cfgPath = dir + L"\\ELOQ.CFG";
     HANDLE hFile = CreateFileW(cfgPath.c_str(), GENERIC_READ | GENERIC_WRITE,
         FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr);
     if (hFile == INVALID_HANDLE_VALUE) return;
@@ -671,19 +3266,8 @@ static void patchEloqCfg(const std::wstring& dir) {
         return;
     }
 
-    // Convert dir to MBCS for comparison/replacement.
-    char mbcsDir[MAX_PATH * 2] = {};
-    WideCharToMultiByte(CP_ACP, 0, dir.c_str(), -1, mbcsDir, sizeof(mbcsDir), nullptr, nullptr);
-    size_t mbcsDirLen = strlen(mbcsDir);
-    // Ensure trailing backslash.
-    if (mbcsDirLen > 0 && mbcsDir[mbcsDirLen - 1] != '\\') {
-        mbcsDir[mbcsDirLen] = '\\';
-        mbcsDir[mbcsDirLen + 1] = '\0';
-        mbcsDirLen++;
-    }
-
     // Check offset 2119 for a path reference and patch if needed.
-    const size_t offset = 2119;
+    const size_t offset = kCfgPathOffset;
     if (offset >= fileSize) {
         CloseHandle(hFile);
         return;
@@ -721,7 +3305,9 @@ static void patchEloqCfg(const std::wstring& dir) {
     // Write back.
     SetFilePointer(hFile, 0, nullptr, FILE_BEGIN);
     DWORD written = 0;
-    WriteFile(hFile, content.data(), (DWORD)content.size(), &written, nullptr);
+    if (WriteFile(hFile, content.data(), (DWORD)content.size(), &written, nullptr) &&
+        written == (DWORD)content.size())
+        g_cfgCheckedDir = dir;
     SetEndOfFile(hFile);
     CloseHandle(hFile);
 }
@@ -730,6 +3316,9 @@ static void patchEloqCfg(const std::wstring& dir) {
 // Version detection
 // ------------------------------------------------------------
 static int detectMode(const std::wstring& dir) {
+    if (dir == L"mock:20") return ELOQ_MODE_20;
+    if (dir == L"mock:33" || dir == L"mock:") return ELOQ_MODE_33;
+
     // 2.0: has ENGSYN32.DLL
     std::wstring engsynPath = dir + L"\\ENGSYN32.DLL";
     if (GetFileAttributesW(engsynPath.c_str()) != INVALID_FILE_ATTRIBUTES)
@@ -775,6 +3364,8 @@ static bool resolveEciFunctions(ELOQ_STATE* s) {
     s->fnNewDict          = (eciNewDictFunc)GetProcAddress(m, "eciNewDict");
     s->fnSetDict          = (eciSetDictFunc)GetProcAddress(m, "eciSetDict");
     s->fnLoadDict         = (eciLoadDictFunc)GetProcAddress(m, "eciLoadDict");
+    s->fnUpdateDict       = (eciUpdateDictFunc)GetProcAddress(m, "eciUpdateDict");
+    s->fnDeleteDict       = (eciDeleteDictFunc)GetProcAddress(m, "eciDeleteDict");
 
     // Minimum required.
     return s->fnNew && s->fnDelete && s->fnSetParam && s->fnAddText &&
@@ -791,19 +3382,532 @@ static void* tryLicense33(ELOQ_STATE* s) {
         return s->fnNew();
     };
 
-    void* h = tryOffset(0);
-    if (!h) h = tryOffset(+3600);
-    if (!h) h = tryOffset(-3600);
-    if (!h) h = s->fnNew(); // last resort without license
-    return h;
+    // Start with the offset that worked last time (later instances and
+    // restarts in this process usually succeed on the first attempt).
+    static std::atomic<int> lastGood{ 0 };
+    const int hint = lastGood.load(std::memory_order_relaxed);
+    const int offsets[3] = { hint, hint == 0 ? +3600 : 0, hint == -3600 ? +3600 : -3600 };
+    void* h = nullptr;
+    for (int off : offsets) {
+        h = tryOffset(off);
+        if (h) {
+            lastGood.store(off, std::memory_order_relaxed);
+            return h;
+        }
+    }
+    return s->fnNew(); // last resort without license
+}
+
+// ECI 3.3 inline annotation names for voice params 1-7: head size, pitch
+// baseline, pitch fluctuation, roughness, breathiness, speed, volume.
+static const char* const kVparamTags[8] = {
+    nullptr, "vh", "vb", "vf", "vr", "vy", "vs", "vv"
+};
+
+// ------------------------------------------------------------
+// Mock engine
+// ------------------------------------------------------------
+// In-process stand-in for ECI32D.DLL behind the same fn* table, selected by
+// an engine directory of "mock:33" or "mock:20". Letters become tone bursts,
+// spaces short gaps and sentence ends long pauses (so the trimmer has work);
+// indexes are reported in stream order and inline `vX annotations set voice
+// params. Synthesis runs on the worker thread through messages to a hidden
+// window, one buffer per message, paced to rtfPermille. 3.3 style fills the
+// registered output buffer and calls the callback; 2.0 style plays through
+// waveOutOpen/Write/Reset, which the armed hooks capture as they do ENGSYN32.
+static ELOQ_MOCK_CONFIG g_mockConfig = { 60, 100, 11025, 16, 2048 };
+static std::mutex g_mockMtx;
+
+static const UINT kMockStepMsg = WM_APP + 0x4D;
+static const UINT_PTR kMockTimerId = 1;
+static const int kMockHeaders = 3;
+
+static bool isMockDir(const std::wstring& dir) {
+    return dir.compare(0, 5, L"mock:") == 0;
+}
+
+struct MockSeg {
+    enum Kind { TONE, SILENCE, INDEX };
+    Kind kind;
+    uint32_t value; // samples (TONE/SILENCE) or index
+};
+
+struct MockEngine {
+    ELOQ_MOCK_CONFIG cfg;
+    bool waveOutStyle = false; // 2.0: play through waveOut
+    HWND hwnd = nullptr;
+    EciCallbackFunc cb = nullptr;
+    void* cbData = nullptr;
+    short* outBuf = nullptr;
+    int outSamples = 0;
+    int params[16] = {};
+    int vparams[8] = { 0, 50, 65, 30, 0, 50, 50, 92 };
+    std::deque<MockSeg> segs; // pending output
+    bool speaking = false;
+    bool stepPosted = false;  // one step message in flight at a time
+    int64_t dueUs = 0;        // ready time of the last buffer
+    uint64_t clock = 0;       // tone sample clock
+    HWAVEOUT wave = nullptr;
+    WAVEHDR hdrs[kMockHeaders] = {};
+    std::vector<uint8_t> hdrData[kMockHeaders];
+    int nextHdr = 0;
+};
+
+static int mockRate(const MockEngine* e) {
+    return e->waveOutStyle ? e->cfg.sampleRate : 11025;
+}
+
+static void mockAppend(MockEngine* e, MockSeg::Kind kind, uint32_t value) {
+    if (kind != MockSeg::INDEX && value == 0) return;
+    if (kind != MockSeg::INDEX && !e->segs.empty() && e->segs.back().kind == kind) {
+        e->segs.back().value += value;
+        return;
+    }
+    e->segs.push_back({ kind, value });
+}
+
+// `vs80 style annotation: two-letter tag, then the value. Spelled out here
+// rather than taken from kVparamTags, so the mock checks that table.
+static void mockAnnotation(MockEngine* e, const char* p, const char* end) {
+    if (end - p < 3 || p[0] != 'v') return;
+    int param = 0;
+    switch (p[1]) {
+    case 'h': param = 1; break; // head size
+    case 'b': param = 2; break; // pitch baseline
+    case 'f': param = 3; break; // pitch fluctuation
+    case 'r': param = 4; break; // roughness
+    case 'y': param = 5; break; // breathiness
+    case 's': param = 6; break; // speed
+    case 'v': param = 7; break; // volume
+    default: return;
+    }
+    e->vparams[param] = atoi(std::string(p + 2, end).c_str());
+}
+
+static void mockParseText(MockEngine* e, const char* text) {
+    const int rate = mockRate(e);
+    for (const char* p = text; *p; p++) {
+        const char c = *p;
+        if (c == '`') {
+            const char* q = p + 1;
+            while (*q && !isTextSpace(*q)) q++;
+            mockAnnotation(e, p + 1, q);
+            p = q - 1;
+            continue;
+        }
+        const int speed = std::max(1, std::min(e->vparams[6], 250));
+        uint32_t ms;
+        MockSeg::Kind kind = MockSeg::SILENCE;
+        if (c == '.' || c == '!' || c == '?') ms = 250;
+        else if (c == ',' || c == ';' || c == ':') ms = 120;
+        else if (isTextSpace(c)) ms = (uint32_t)e->cfg.msPerChar / 2;
+        else { ms = (uint32_t)e->cfg.msPerChar; kind = MockSeg::TONE; }
+        mockAppend(e, kind, (uint32_t)((uint64_t)ms * 50 / speed * rate / 1000));
+    }
+}
+
+static void mockFillPcm(MockEngine* e, uint8_t* dst, int bits, MockSeg::Kind kind, uint32_t n) {
+    const int rate = mockRate(e);
+    const double amp = 12000.0 * std::max(0, std::min(e->vparams[7], 100)) / 100.0;
+    const double f0 = 80.0 + 2.0 * e->vparams[2];
+    for (uint32_t i = 0; i < n; i++, e->clock++) {
+        double v = 0;
+        if (kind == MockSeg::TONE) {
+            const double w = (double)e->clock / rate * 2 * 3.14159265 * f0;
+            v = (std::sin(w) * 0.7 + std::sin(w * 3) * 0.3) * amp;
+        }
+        if (bits == 8) dst[i] = (uint8_t)(128 + (int)(v / 256));
+        else reinterpret_cast<int16_t*>(dst)[i] = (int16_t)v;
+    }
+}
+
+static void mockSchedule(MockEngine* e) {
+    if (e->stepPosted) return;
+    e->stepPosted = PostMessageW(e->hwnd, kMockStepMsg, 0, 0) != 0;
+}
+
+static void mockStopSynthesis(MockEngine* e) {
+    e->segs.clear();
+    e->speaking = false;
+    if (e->hwnd) KillTimer(e->hwnd, kMockTimerId);
+}
+
+static void CALLBACK mockWaveProc(HWAVEOUT, UINT, DWORD_PTR, DWORD_PTR, DWORD_PTR) {
+    // Headers are reused round-robin; nothing to do on WOM_DONE.
+}
+
+// Delivers n samples of the given kind. False once the engine was stopped
+// (eciDataAbort from the callback).
+static bool mockDeliverAudio(MockEngine* e, MockSeg::Kind kind, uint32_t n) {
+    if (!e->waveOutStyle) {
+        if (!e->outBuf) return true;
+        mockFillPcm(e, reinterpret_cast<uint8_t*>(e->outBuf), 16, kind, n);
+        if (e->cb && e->cb((int)(intptr_t)e, 0, (int)n, e->cbData) == 2) {
+            mockStopSynthesis(e);
+            return false;
+        }
+        return true;
+    }
+
+    const int bits = e->cfg.bitsPerSample == 8 ? 8 : 16;
+    if (!e->wave) {
+        WAVEFORMATEX f = {};
+        f.wFormatTag = WAVE_FORMAT_PCM;
+        f.nChannels = 1;
+        f.nSamplesPerSec = (DWORD)e->cfg.sampleRate;
+        f.wBitsPerSample = (WORD)bits;
+        f.nBlockAlign = (WORD)(bits / 8);
+        f.nAvgBytesPerSec = f.nSamplesPerSec * f.nBlockAlign;
+        if (waveOutOpen(&e->wave, WAVE_MAPPER, &f, (DWORD_PTR)mockWaveProc, (DWORD_PTR)e,
+                CALLBACK_FUNCTION) != MMSYSERR_NOERROR) {
+            e->wave = nullptr;
+            return true;
+        }
+    }
+    WAVEHDR& h = e->hdrs[e->nextHdr];
+    std::vector<uint8_t>& data = e->hdrData[e->nextHdr];
+    e->nextHdr = (e->nextHdr + 1) % kMockHeaders;
+    if (h.dwFlags & WHDR_PREPARED) waveOutUnprepareHeader(e->wave, &h, sizeof(h));
+    data.resize((size_t)n * (bits / 8));
+    mockFillPcm(e, data.data(), bits, kind, n);
+    memset(&h, 0, sizeof(h));
+    h.lpData = reinterpret_cast<LPSTR>(data.data());
+    h.dwBufferLength = (DWORD)data.size();
+    waveOutPrepareHeader(e->wave, &h, sizeof(h));
+    waveOutWrite(e->wave, &h, sizeof(h));
+    return e->speaking;
+}
+
+static bool mockDeliverIndex(MockEngine* e, int index) {
+    if (e->cb && e->cb((int)(intptr_t)e, 2, index, e->cbData) == 2) {
+        mockStopSynthesis(e);
+        return false;
+    }
+    return true;
+}
+
+static void mockFinish(MockEngine* e) {
+    e->speaking = false;
+    if (e->waveOutStyle) {
+        if (e->cb) e->cb((int)(intptr_t)e, 2, 0xFFFF, e->cbData);
+        if (e->wave) waveOutReset(e->wave);
+    } else if (e->cb) {
+        e->cb((int)(intptr_t)e, 0, 0, e->cbData);
+    }
+}
+
+// Emits the next buffer (audio up to the next index or the buffer size),
+// then schedules the following one.
+static void mockStep(MockEngine* e, bool paced) {
+    if (!e->speaking) return;
+    while (!e->segs.empty() && e->segs.front().kind == MockSeg::INDEX) {
+        const int index = (int)e->segs.front().value;
+        e->segs.pop_front();
+        if (!mockDeliverIndex(e, index)) return;
+    }
+    if (e->segs.empty()) {
+        mockFinish(e);
+        return;
+    }
+
+    // A buffer is ready once its share of synthesis time has passed.
+    MockSeg& seg = e->segs.front();
+    const uint32_t cap = (uint32_t)(e->waveOutStyle ? e->cfg.bufferSamples : e->outSamples);
+    const uint32_t n = std::min(seg.value, std::max<uint32_t>(cap, 1));
+    const int64_t due = e->dueUs + (int64_t)n * 1000000 / mockRate(e) * e->cfg.rtfPermille / 1000;
+    const int64_t now = nowUs();
+    if (paced && now < due) {
+        SetTimer(e->hwnd, kMockTimerId, (UINT)std::max<int64_t>(1, (due - now) / 1000), nullptr);
+        return;
+    }
+
+    const MockSeg::Kind kind = seg.kind;
+    seg.value -= n;
+    if (seg.value == 0) e->segs.pop_front();
+    e->dueUs = due;
+    if (!mockDeliverAudio(e, kind, n)) return;
+    if (paced) mockSchedule(e);
+}
+
+static LRESULT CALLBACK mockWndProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
+    MockEngine* e = reinterpret_cast<MockEngine*>(GetWindowLongPtrW(hwnd, GWLP_USERDATA));
+    if (e && (msg == kMockStepMsg || (msg == WM_TIMER && wp == kMockTimerId))) {
+        if (msg == WM_TIMER) KillTimer(hwnd, kMockTimerId);
+        else e->stepPosted = false;
+        mockStep(e, true);
+        return 0;
+    }
+    return DefWindowProcW(hwnd, msg, wp, lp);
+}
+
+static void* mockCreate(bool waveOutStyle) {
+    static LONG registered = 0;
+    if (InterlockedCompareExchange(&registered, 1, 0) == 0) {
+        WNDCLASSW wc = {};
+        wc.lpfnWndProc = mockWndProc;
+        wc.hInstance = GetModuleHandleW(nullptr);
+        wc.lpszClassName = L"EloqMockEngine";
+        RegisterClassW(&wc);
+    }
+    MockEngine* e = new MockEngine();
+    {
+        std::lock_guard<std::mutex> g(g_mockMtx);
+        e->cfg = g_mockConfig;
+    }
+    e->waveOutStyle = waveOutStyle;
+    e->hwnd = CreateWindowExW(0, L"EloqMockEngine", L"", 0, 0, 0, 0, 0, HWND_MESSAGE,
+        nullptr, GetModuleHandleW(nullptr), nullptr);
+    if (!e->hwnd) {
+        delete e;
+        return nullptr;
+    }
+    SetWindowLongPtrW(e->hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(e));
+    return e;
+}
+
+static void* __stdcall mockNew33() { return mockCreate(false); }
+static void* __stdcall mockNew20() { return mockCreate(true); }
+
+static void __stdcall mockDelete(void* h) {
+    MockEngine* e = static_cast<MockEngine*>(h);
+    if (!e) return;
+    mockStopSynthesis(e);
+    if (e->wave) {
+        for (WAVEHDR& hdr : e->hdrs)
+            if (hdr.dwFlags & WHDR_PREPARED) waveOutUnprepareHeader(e->wave, &hdr, sizeof(hdr));
+        waveOutClose(e->wave);
+    }
+    if (e->hwnd) DestroyWindow(e->hwnd);
+    delete e;
+}
+
+static void __stdcall mockRequestLicense(int) {}
+
+static int __stdcall mockSetOutputBuffer(void* h, int samples, void* buffer) {
+    MockEngine* e = static_cast<MockEngine*>(h);
+    e->outSamples = samples;
+    e->outBuf = static_cast<short*>(buffer);
+    return 1;
+}
+
+static int __stdcall mockSetOutputDevice(void*, int) { return 1; }
+
+static int __stdcall mockRegisterCallback(void* h, void* cb, void* data) {
+    MockEngine* e = static_cast<MockEngine*>(h);
+    e->cb = reinterpret_cast<EciCallbackFunc>(cb);
+    e->cbData = data;
+    return 1;
+}
+
+static int __stdcall mockSetParam(void* h, int param, int value) {
+    MockEngine* e = static_cast<MockEngine*>(h);
+    if (param < 0 || param >= 16) return -1;
+    const int prev = e->params[param];
+    e->params[param] = value;
+    return prev;
+}
+
+static int __stdcall mockGetParam(void* h, int param) {
+    MockEngine* e = static_cast<MockEngine*>(h);
+    return (param >= 0 && param < 16) ? e->params[param] : -1;
+}
+
+static int __stdcall mockSetVoiceParam(void* h, int, int param, int value) {
+    MockEngine* e = static_cast<MockEngine*>(h);
+    if (param < 1 || param > 7) return -1;
+    const int prev = e->vparams[param];
+    e->vparams[param] = value;
+    return prev;
+}
+
+static int __stdcall mockGetVoiceParam(void* h, int, int param) {
+    MockEngine* e = static_cast<MockEngine*>(h);
+    return (param >= 1 && param <= 7) ? e->vparams[param] : -1;
+}
+
+// Variants differ in pitch and head size only.
+static int __stdcall mockCopyVoice(void* h, int variant, int) {
+    MockEngine* e = static_cast<MockEngine*>(h);
+    e->vparams[1] = 50 + (variant % 4) * 5;
+    e->vparams[2] = 65 + (variant % 8) * 4;
+    return 1;
+}
+
+static int __stdcall mockAddText(void* h, const char* text) {
+    if (text) mockParseText(static_cast<MockEngine*>(h), text);
+    return 1;
+}
+
+static int __stdcall mockInsertIndex(void* h, int index) {
+    mockAppend(static_cast<MockEngine*>(h), MockSeg::INDEX, (uint32_t)index);
+    return 1;
+}
+
+static int __stdcall mockSynthesize(void* h) {
+    MockEngine* e = static_cast<MockEngine*>(h);
+    if (!e->speaking) {
+        e->speaking = true;
+        e->dueUs = nowUs();
+        mockSchedule(e);
+    }
+    return 1;
+}
+
+static int __stdcall mockStop(void* h) {
+    mockStopSynthesis(static_cast<MockEngine*>(h));
+    return 1;
+}
+
+static int __stdcall mockSpeaking(void* h) {
+    return static_cast<MockEngine*>(h)->speaking ? 1 : 0;
+}
+
+static int __stdcall mockSynchronize(void* h) {
+    MockEngine* e = static_cast<MockEngine*>(h);
+    while (e->speaking) mockStep(e, false);
+    return 1;
+}
+
+static int __stdcall mockNewDict(void*) { return 1; }
+static int __stdcall mockSetDict(void*, int) { return 0; }
+static int __stdcall mockLoadDict(void*, int, int, const char*) { return 0; }
+static int __stdcall mockUpdateDict(void*, int, int, const char*, const char*) { return 0; }
+static int __stdcall mockDeleteDict(void*, int) { return 0; }
+
+static void bindMockFunctions(ELOQ_STATE* s) {
+    s->fnNew              = (s->mode == ELOQ_MODE_20) ? mockNew20 : mockNew33;
+    s->fnDelete           = mockDelete;
+    s->fnRequestLicense   = mockRequestLicense;
+    s->fnSetOutputBuffer  = mockSetOutputBuffer;
+    s->fnSetOutputDevice  = mockSetOutputDevice;
+    s->fnRegisterCallback = mockRegisterCallback;
+    s->fnSetParam         = mockSetParam;
+    s->fnGetParam         = mockGetParam;
+    s->fnSetVoiceParam    = mockSetVoiceParam;
+    s->fnGetVoiceParam    = mockGetVoiceParam;
+    s->fnCopyVoice        = mockCopyVoice;
+    s->fnAddText          = mockAddText;
+    s->fnInsertIndex      = mockInsertIndex;
+    s->fnSynthesize       = mockSynthesize;
+    s->fnStop             = mockStop;
+    s->fnSpeaking         = mockSpeaking;
+    s->fnSynchronize      = mockSynchronize;
+    s->fnVersion          = nullptr;
+    s->fnNewDict          = mockNewDict;
+    s->fnSetDict          = mockSetDict;
+    s->fnLoadDict         = mockLoadDict;
+    s->fnUpdateDict       = mockUpdateDict;
+    s->fnDeleteDict       = mockDeleteDict;
+}
+
+extern "C" ELOQ_API int __cdecl eloq_set_mock_config(const ELOQ_MOCK_CONFIG* cfg) {
+    if (!cfg) return -1;
+    if (cfg->msPerChar < 1 || cfg->msPerChar > 1000 ||
+        cfg->rtfPermille < 0 || cfg->rtfPermille > 100000 ||
+        cfg->sampleRate < 8000 || cfg->sampleRate > 48000 ||
+        (cfg->bitsPerSample != 8 && cfg->bitsPerSample != 16) ||
+        cfg->bufferSamples < 64 || cfg->bufferSamples > 65536)
+        return -1;
+    std::lock_guard<std::mutex> g(g_mockMtx);
+    g_mockConfig = *cfg;
+    return 0;
 }
 
 // ------------------------------------------------------------
 // Worker thread: apply settings, synthesize, wait for done
 // ------------------------------------------------------------
+// Creates the sonic stream for the current format, or recreates it if the
+// format changed (2.0 may reopen waveOut), and points its rate at the
+// requested output sample rate. Worker thread only.
+static void ensureSonicStream(ELOQ_STATE* s) {
+    if (!s->formatValid) return;
+    const int rate = (int)s->lastFormat.nSamplesPerSec;
+    const int nch = (int)s->lastFormat.nChannels;
+    const int bits = (int)s->lastFormat.wBitsPerSample;
+    if (!s->sonicStream ||
+        sonicGetSampleRate(s->sonicStream) != rate ||
+        sonicGetNumChannels(s->sonicStream) != nch) {
+        if (s->sonicStream) sonicDestroyStream(s->sonicStream);
+        s->sonicStream = sonicCreateStream(rate, nch);
+        if (s->sonicStream) sonicSetSpeed(s->sonicStream, s->rateBoost);
+    }
+
+    int outRate = s->sonicStream ? s->outRate.value.load(std::memory_order_relaxed) : 0;
+    int outBits = s->sonicStream ? s->outBits.value.load(std::memory_order_relaxed) : 0;
+    if (outRate == rate || rate <= 0) outRate = 0;
+    if (outBits == bits || (bits != 8 && bits != 16)) outBits = 0;
+    if (s->sonicStream) {
+        const float r = outRate ? (float)rate / (float)outRate : 1.0f;
+        // sonicSetRate restarts the interpolator; only touch it on change.
+        if (sonicGetRate(s->sonicStream) != r) sonicSetRate(s->sonicStream, r);
+    }
+    s->outRateApplied = outRate;
+    s->outBitsApplied = outBits;
+}
+
+// Converts the watermark settings to bytes of the current output format.
+// Worker thread, between utterances.
+static void updateWatermarks(ELOQ_STATE* s) {
+    const uint64_t bps = s->formatValid ? outputFormat(s).nAvgBytesPerSec : 0;
+    const uint64_t high = (uint64_t)s->highWaterMs.load(std::memory_order_relaxed);
+    const uint64_t low = (uint64_t)s->lowWaterMs.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> g(s->outMtx);
+    if (bps == 0 || high == 0) {
+        s->highWaterBytes = 0;
+        s->lowWaterBytes = 0;
+        return;
+    }
+    // Stay below the ring capacity so throttling kicks in before overruns.
+    const uint64_t cap = s->pcm.capacity() * 3 / 4;
+    s->highWaterBytes = (size_t)std::min(bps * high / 1000, cap);
+    s->lowWaterBytes = (size_t)std::min(bps * low / 1000, (uint64_t)s->highWaterBytes);
+}
+
+static void publishSettings(ELOQ_STATE* s) {
+    s->settingsVersion.fetch_add(1, std::memory_order_release);
+}
+
+static void storeSetting(SettingInt& st, int v) {
+    st.value.store(v, std::memory_order_relaxed);
+    st.dirty.store(1, std::memory_order_relaxed);
+}
+
+// An annotated param must still be re-sent if the utterance carrying it was
+// stopped before the engine parsed that far.
+static void requeueInlineParams(ELOQ_STATE* s, unsigned mask) {
+    for (int i = 1; i <= 7; i++) {
+        if (!(mask & (1u << i))) continue;
+        s->appliedVparams[i] = INT_MIN;
+        s->vparams[i].dirty.store(1, std::memory_order_relaxed);
+    }
+    publishSettings(s);
+}
+
 static void applyDirtySettings(ELOQ_STATE* s) {
     if (!s || !s->handle) return;
 
+    // Rate boost: only the speed changes; the stream itself is reused.
+    ensureSonicStream(s);
+
+    const uint32_t ver = s->settingsVersion.load(std::memory_order_acquire);
+    if (ver == s->appliedVersion) return;
+    s->appliedVersion = ver;
+
+    if (s->rateBoostPct.dirty.exchange(0, std::memory_order_relaxed)) {
+        const float rate = (float)s->rateBoostPct.value.load(std::memory_order_relaxed) / 100.0f;
+        if (rate != s->rateBoost) {
+            s->rateBoost = rate;
+            if (s->sonicStream) sonicSetSpeed(s->sonicStream, rate);
+        }
+    }
+
+    // Output format: ensureSonicStream picks the values up.
+    const bool outRateDirty = s->outRate.dirty.exchange(0, std::memory_order_relaxed) != 0;
+    if ((s->outBits.dirty.exchange(0, std::memory_order_relaxed) != 0) || outRateDirty) {
+        ensureSonicStream(s);
+        dbgInfo("worker: output format rate=%d bits=%d", s->outRateApplied, s->outBitsApplied);
+    }
+
     // Voice/language change (3.3 only, param 9).
     if (s->mode == ELOQ_MODE_33 && s->voice.dirty.exchange(0, std::memory_order_relaxed)) {
         int v = s->voice.value.load(std::memory_order_relaxed);
@@ -813,23 +3917,259 @@ static void applyDirtySettings(ELOQ_STATE* s) {
         }
     }
 
-    // Variant change (eciCopyVoice).
+    // Output buffer size (3.3): the engine is idle, so the buffer can be
+    // reallocated and registered again.
+    if (s->mode == ELOQ_MODE_33 && s->eciBufferSamples.dirty.exchange(0, std::memory_order_relaxed)) {
+        const size_t n = (size_t)s->eciBufferSamples.value.load(std::memory_order_relaxed);
+        if (n != s->eciBuffer.size() && s->fnSetOutputBuffer) {
+            s->eciBuffer.assign(n, 0);
+            s->fnSetOutputBuffer(s->handle, (int)n, s->eciBuffer.data());
+            dbg("worker: output buffer now %zu samples", n);
+        }
+    }
+
+    // Variant change (eciCopyVoice) loads the preset's params. Read them back
+    // so untouched params report the preset and changed ones are only sent
+    // where they differ from it; unsent annotations are built again.
+    unsigned force = 0;
     if (s->variant.dirty.exchange(0, std::memory_order_relaxed)) {
         int v = s->variant.value.load(std::memory_order_relaxed);
         if (v != s->currentVariant && s->fnCopyVoice) {
             s->fnCopyVoice(s->handle, v, 0);
             s->currentVariant = v;
+            force = s->inlineMask;
+            s->inlinePrefix.clear();
+            s->inlineMask = 0;
+            if (s->fnGetVoiceParam) {
+                for (int i = 1; i <= 7; i++) {
+                    s->appliedVparams[i] = s->fnGetVoiceParam(s->handle, 0, i);
+                    if (!(force & (1u << i)) && !s->vparams[i].dirty.load(std::memory_order_relaxed))
+                        s->vparams[i].value.store(s->appliedVparams[i], std::memory_order_relaxed);
+                }
+            }
         }
     }
 
-    // Voice parameters 1-7.
+    // Voice parameters 1-7: net delta against what the engine has.
+    int delta[8];
+    int numDelta = 0;
+    for (int i = 1; i <= 7; i++) {
+        delta[i] = INT_MIN;
+        const bool dirty = s->vparams[i].dirty.exchange(0, std::memory_order_relaxed) != 0;
+        if (!dirty && !(force & (1u << i))) continue;
+        const int v = s->vparams[i].value.load(std::memory_order_relaxed);
+        if (v == s->appliedVparams[i]) continue;
+        delta[i] = v;
+        ++numDelta;
+    }
+    if (numDelta == 0) return;
+
+    // One annotated AddText beats several API calls; a single change only
+    // goes inline if an earlier annotation for it is still pending.
+    const bool annotate = s->mode == ELOQ_MODE_33 &&
+        s->inlineParams.load(std::memory_order_relaxed) != 0;
     for (int i = 1; i <= 7; i++) {
-        if (s->vparams[i].dirty.exchange(0, std::memory_order_relaxed)) {
-            int v = s->vparams[i].value.load(std::memory_order_relaxed);
-            if (s->fnSetVoiceParam)
-                s->fnSetVoiceParam(s->handle, 0, i, v);
+        const int v = delta[i];
+        if (v == INT_MIN) continue;
+        if (annotate && v >= 0 && (numDelta >= 2 || (s->inlineMask & (1u << i)))) {
+            char tag[16];
+            snprintf(tag, sizeof(tag), "`%s%d ", kVparamTags[i], v);
+            s->inlinePrefix += tag;
+            s->inlineMask |= 1u << i;
+        } else if (s->fnSetVoiceParam) {
+            s->fnSetVoiceParam(s->handle, 0, i, v);
+        }
+        s->appliedVparams[i] = v;
+    }
+}
+
+static DWORD utteranceTimeout(const ELOQ_STATE* s, size_t bytes) {
+    const uint64_t ms = (uint64_t)s->timeoutBaseMs.load(std::memory_order_relaxed) +
+        (uint64_t)s->timeoutPerByteMs.load(std::memory_order_relaxed) * bytes;
+    return (DWORD)std::min<uint64_t>(ms, 600000);
+}
+
+// Called by the worker once a canceled utterance is stopped and quiet.
+static void recordStopLatency(ELOQ_STATE* s) {
+    const int64_t req = s->stopRequestUs.exchange(0, std::memory_order_relaxed);
+    if (req == 0) return; // timeout, not a caller stop
+    const int64_t d = nowUs() - req;
+    s->stopLatency.add(d);
+    dbg("worker: stop latency %lld us", (long long)d);
+}
+
+// Ends a generation: DONE for the stream, or completion of a render job.
+static void finishGeneration(ELOQ_STATE* s, uint32_t gen, RenderJob* job, bool canceled) {
+    s->activeGen.store(0, std::memory_order_relaxed);
+    if (job) {
+        s->render = nullptr;
+        s->sideGen.store(0, std::memory_order_relaxed);
+        renderClose(s, job);
+        dbg("worker: render done bytes=%llu canceled=%d", (unsigned long long)job->dataBytes, canceled);
+        renderComplete(job, job->ioError ? -7 : (canceled || job->aborted) ? -6 : 0);
+        return;
+    }
+    pushMarker(s, ELOQ_ITEM_DONE, isUrgentGen(s, gen) ? ELOQ_DONE_URGENT : 0, gen);
+    dbg("worker: pushed DONE marker, currentGen=%u", s->currentGen.load(std::memory_order_relaxed));
+}
+
+// Phrase cache key prefix: every setting that changes the rendered audio.
+static const size_t kPhraseCacheMaxText = 256; // bytes of preprocessed text
+static const size_t kFingerprintBytes = 13 * sizeof(int);
+
+static std::string settingsFingerprint(const ELOQ_STATE* s) {
+    int v[13];
+    v[0] = s->currentVariant;
+    v[1] = s->currentVoice;
+    for (int i = 1; i <= 7; i++)
+        v[1 + i] = s->vparams[i].value.load(std::memory_order_relaxed);
+    v[9] = (int)(s->rateBoost * 100.0f + 0.5f);
+    v[10] = (int)s->dictVersion.load(std::memory_order_relaxed);
+    v[11] = s->outRateApplied;
+    v[12] = s->outBitsApplied;
+    static_assert(sizeof(v) == kFingerprintBytes, "fingerprint size");
+    return std::string(reinterpret_cast<const char*>(v), sizeof(v));
+}
+
+// Pushes a cached phrase into the current generation, markers in place.
+static void replayPhrase(ELOQ_STATE* s, uint32_t gen, const PhraseEntry& e) {
+    size_t pos = 0;
+    for (const StreamMarker& m : e.markers) {
+        if (m.bytePos > pos) {
+            pushAudioToQueue(s, gen, e.pcm.data() + pos, (size_t)m.bytePos - pos);
+            pos = (size_t)m.bytePos;
+        }
+        pushMarker(s, m.type, m.value, gen);
+    }
+    if (pos < e.pcm.size())
+        pushAudioToQueue(s, gen, e.pcm.data() + pos, e.pcm.size() - pos);
+}
+
+// Puts resume commands at the front of the normal lane, in the given order.
+static void requeueFront(ELOQ_STATE* s, std::vector<Cmd>& cmds) {
+    std::lock_guard<std::mutex> lk(s->cmdMtx);
+    for (size_t i = cmds.size(); i-- > 0;) s->cmdQ.push_front(std::move(cmds[i]));
+    SetEvent(s->cmdEvent);
+}
+
+// Urgent text interrupted gen mid-synthesis (engine already stopped): its
+// unheard output up to the last chunk boundary and the chunks after it
+// become a resume command, so only unfinished text is synthesized again.
+static void suspendGeneration(ELOQ_STATE* s, uint32_t gen, uint32_t cancelSnapshot, size_t nextChunk) {
+    Cmd r;
+    r.cancelSnapshot = cancelSnapshot;
+    r.queued = true;
+    r.resume = std::make_shared<PhraseEntry>();
+    size_t from = 0;
+    {
+        std::lock_guard<std::mutex> g(s->outMtx);
+        if (s->resumeGen == gen && s->resumeChunkRaw >= 0) {
+            // Boundary indexes carry the chunk number modulo the mask.
+            for (size_t k = nextChunk; k-- > 0;) {
+                if ((int)(k & kChunkIndexMask) == s->resumeChunkRaw) {
+                    from = k + 1;
+                    break;
+                }
+            }
+        }
+        const bool samePlace = s->resumeInRing == (gen == s->currentGen.load(std::memory_order_relaxed));
+        takeOutputLocked(s, gen, (s->resumeGen == gen && samePlace) ? s->resumePos : 0, *r.resume);
+        s->resumeGen = 0;
+    }
+    for (size_t k = from; k < s->textChunks.size(); k++) {
+        if (!r.text.empty()) r.text += ' ';
+        r.text += s->textChunks[k];
+    }
+    dbg("worker: gen=%u suspended at chunk %zu/%zu, %zu bytes kept",
+        gen, from, s->textChunks.size(), r.resume->pcm.size());
+    std::vector<Cmd> cmds;
+    cmds.push_back(std::move(r));
+    requeueFront(s, cmds);
+}
+
+// Before urgent text plays: unheard output of normal-lane generations the
+// engine has finished (the reader's, then a staged one) moves into resume
+// commands with no text left to synthesize.
+static void suspendReaderOutput(ELOQ_STATE* s) {
+    std::vector<Cmd> cmds;
+    {
+        std::lock_guard<std::mutex> g(s->outMtx);
+        const uint32_t cur = s->currentGen.load(std::memory_order_relaxed);
+        const uint32_t side = s->sideGen.load(std::memory_order_relaxed);
+        const bool ringLeft = cur != 0 && s->outGen == cur && !isUrgentGen(s, cur) &&
+            (s->pcm.size() > 0 || !s->markers.empty());
+        const bool stageLeft = s->staged && !isUrgentGen(s, side);
+        for (int i = 0; i < 2; i++) {
+            if (!(i == 0 ? ringLeft : stageLeft)) continue;
+            Cmd r;
+            r.cancelSnapshot = s->cancelToken.load(std::memory_order_relaxed);
+            r.queued = true;
+            r.resume = std::make_shared<PhraseEntry>();
+            takeOutputLocked(s, i == 0 ? cur : side, UINT64_MAX, *r.resume);
+            cmds.push_back(std::move(r));
+        }
+    }
+    if (cmds.empty()) return;
+    dbg("worker: %zu finished generation(s) set aside for urgent text", cmds.size());
+    requeueFront(s, cmds);
+}
+
+// Warm-up phrase: words, digits and sentence punctuation, enough to page
+// in the main text-normalization and synthesis tables.
+static const char kWarmUpText[] = "Warming up, 1 2 3. Xylophone?";
+
+// Synthesizes kWarmUpText in the instance's current voice with the output
+// discarded under generation 0: the engine pages in its tables and the
+// trim/sonic scratch buffers grow to their steady-state size. Gives way to
+// the first command, and no phrase runs once one is already queued.
+static void warmUp(ELOQ_STATE* s) {
+    int result = ELOQ_READY_COLD;
+    if (s->warmup && WaitForSingleObject(s->cmdEvent, 0) != WAIT_OBJECT_0) {
+        applyDirtySettings(s);
+        const int64_t t0 = nowUs();
+        s->warming = true;
+        ResetEvent(s->doneEvent);
+        s->fnAddText(s->handle, kWarmUpText);
+        s->fnSynthesize(s->handle);
+
+        HANDLE waits[2] = { s->doneEvent, s->cmdEvent };
+        const DWORD start = GetTickCount();
+        bool done = false;
+        MSG msg;
+        for (;;) {
+            const DWORD elapsed = GetTickCount() - start;
+            if (elapsed >= 5000) {
+                dbgError("worker: warm-up did not finish in 5 s");
+                break;
+            }
+            // 2.0 may finish without touching waveOut; poll it as priming does.
+            if (s->mode == ELOQ_MODE_20 && s->fnSpeaking && !s->fnSpeaking(s->handle)) {
+                done = true;
+                break;
+            }
+            const DWORD slice = s->mode == ELOQ_MODE_20 ? std::min<DWORD>(50, 5000 - elapsed) : 5000 - elapsed;
+            const DWORD w = MsgWaitForMultipleObjectsEx(2, waits, slice, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+            if (w == WAIT_OBJECT_0) {
+                done = true;
+                break;
+            }
+            if (w == WAIT_TIMEOUT) continue;
+            if (w != WAIT_OBJECT_0 + 2) break; // a command is waiting
+            while (PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE)) {
+                TranslateMessage(&msg);
+                DispatchMessageW(&msg);
+            }
         }
+        if (s->fnStop) s->fnStop(s->handle);
+        s->warming = false;
+        ResetEvent(s->doneEvent);
+        s->silenceSamples = 0;
+        if (s->sonicStream) sonicResetStream(s->sonicStream);
+        if (done) result = ELOQ_READY_WARM;
+        dbgInfo("worker: warm-up %s after %lld ms", done ? "done" : "cut short",
+            (long long)((nowUs() - t0) / 1000));
     }
+    s->warmState.store(result, std::memory_order_relaxed);
 }
 
 static void workerLoop(ELOQ_STATE* s) {
@@ -849,68 +4189,77 @@ static void workerLoop(ELOQ_STATE* s) {
 
     // For 2.0: install hooks BEFORE loading DLLs (ENGSYN32 may init early).
     if (s->mode == ELOQ_MODE_20) {
-        dbg("worker: installing waveOut hooks for mode 20");
-        if (!ensureHooksInstalled()) {
-            dbg("worker: hook installation FAILED");
+        dbgInfo("worker: installing waveOut hooks for mode 20");
+        if (!armHooks(s)) {
+            dbgError("worker: hook installation FAILED");
             s->initOk.store(-1, std::memory_order_relaxed);
             if (s->initEvent) SetEvent(s->initEvent);
             return;
         }
-        dbg("worker: hooks installed OK");
+        dbgInfo("worker: hooks installed OK");
     }
 
-    // Set DLL search directory so implicit dependencies (e.g. ENGSYN32.DLL
-    // imported by ECI32D.DLL in 2.0 mode) are found in the engine folder.
-    dbg("worker: SetDllDirectoryW('%ls')", s->dllDir.c_str());
-    SetDllDirectoryW(s->dllDir.c_str());
-
-    // Load Borland runtime first (all other DLLs depend on it).
-    dbg("worker: loading CW3220MT.DLL...");
-    if (GetFileAttributesW(cwlPath.c_str()) != INVALID_FILE_ATTRIBUTES) {
-        s->cwlModule = LoadLibraryW(cwlPath.c_str());
-        dbg("worker: CW3220MT.DLL = %p", s->cwlModule);
+    if (s->mock) {
+        // Mock backend: no engine DLLs, the fn* table is filled in-process.
+        dbgInfo("worker: binding mock engine (mode=%d)", s->mode);
+        bindMockFunctions(s);
     } else {
-        dbg("worker: CW3220MT.DLL not found, skipping");
-    }
+        // Set DLL search directory so implicit dependencies (e.g. ENGSYN32.DLL
+        // imported by ECI32D.DLL in 2.0 mode) are found in the engine folder.
+        dbgInfo("worker: SetDllDirectoryW('%ls')", s->dllDir.c_str());
+        SetDllDirectoryW(s->dllDir.c_str());
+
+        // Load Borland runtime first (all other DLLs depend on it).
+        dbgInfo("worker: loading CW3220MT.DLL...");
+        if (GetFileAttributesW(cwlPath.c_str()) != INVALID_FILE_ATTRIBUTES) {
+            s->cwlModule = LoadLibraryW(cwlPath.c_str());
+            dbgInfo("worker: CW3220MT.DLL = %p", s->cwlModule);
+        } else {
+            dbgInfo("worker: CW3220MT.DLL not found, skipping");
+        }
 
-    // Load ECI32D.DLL.
-    dbg("worker: loading ECI32D.DLL...");
-    s->eciModule = LoadLibraryW(eciPath.c_str());
-    dbg("worker: ECI32D.DLL = %p (err=%lu)", s->eciModule, s->eciModule ? 0 : GetLastError());
+        // Load ECI32D.DLL.
+        dbgInfo("worker: loading ECI32D.DLL...");
+        s->eciModule = LoadLibraryW(eciPath.c_str());
+        dbgInfo("worker: ECI32D.DLL = %p (err=%lu)", s->eciModule, s->eciModule ? 0 : GetLastError());
 
-    // Restore default DLL search order.
-    SetDllDirectoryW(nullptr);
-    if (!s->eciModule) {
-        s->initOk.store(-1, std::memory_order_relaxed);
-        if (s->initEvent) SetEvent(s->initEvent);
-        return;
-    }
+        // Restore default DLL search order.
+        SetDllDirectoryW(nullptr);
+        if (!s->eciModule) {
+            s->initOk.store(-1, std::memory_order_relaxed);
+            if (s->initEvent) SetEvent(s->initEvent);
+            return;
+        }
 
-    // For 2.0: get handle to ENGSYN32.DLL (loaded as ECI32D import).
-    // Speech.dll is loaded lazily during priming, so we grab it later.
-    if (s->mode == ELOQ_MODE_20) {
-        s->engsynModule = GetModuleHandleW(L"ENGSYN32.DLL");
-        dbg("worker: ENGSYN32.DLL = %p", s->engsynModule);
-    }
+        // For 2.0: get handle to ENGSYN32.DLL (loaded as ECI32D import).
+        // Speech.dll is loaded lazily during priming, so we grab it later.
+        if (s->mode == ELOQ_MODE_20) {
+            s->engsynModule = GetModuleHandleW(L"ENGSYN32.DLL");
+            dbgInfo("worker: ENGSYN32.DLL = %p", s->engsynModule);
+            addModuleRange(s->eciModule);
+            addModuleRange(s->engsynModule);
+            addModuleRange(s->cwlModule);
+        }
 
-    dbg("worker: resolving ECI functions...");
-    if (!resolveEciFunctions(s)) {
-        dbg("worker: resolveEciFunctions FAILED");
-        s->initOk.store(-1, std::memory_order_relaxed);
-        if (s->initEvent) SetEvent(s->initEvent);
-        return;
+        dbgInfo("worker: resolving ECI functions...");
+        if (!resolveEciFunctions(s)) {
+            dbgError("worker: resolveEciFunctions FAILED");
+            s->initOk.store(-1, std::memory_order_relaxed);
+            if (s->initEvent) SetEvent(s->initEvent);
+            return;
+        }
+        dbgInfo("worker: ECI functions resolved OK");
     }
-    dbg("worker: ECI functions resolved OK");
 
     // Create ECI handle.
-    dbg("worker: creating ECI handle (mode=%d)...", s->mode);
+    dbgInfo("worker: creating ECI handle (mode=%d)...", s->mode);
     if (s->mode == ELOQ_MODE_33) {
-        patchEloqCfg(s->dllDir);
+        if (!s->mock) patchEloqCfg(s->dllDir);
         s->handle = tryLicense33(s);
     } else {
         s->handle = s->fnNew();
     }
-    dbg("worker: ECI handle = %p", s->handle);
+    dbgInfo("worker: ECI handle = %p", s->handle);
 
     if (!s->handle) {
         s->initOk.store(-1, std::memory_order_relaxed);
@@ -921,24 +4270,26 @@ static void workerLoop(ELOQ_STATE* s) {
     // ---- Mode-specific setup ----
     if (s->mode == ELOQ_MODE_33) {
         // Register callback FIRST (matches old driver order).
-        dbg("worker: RegisterCallback(fn=%p)", (void*)eciCallback);
-        int cbRc = s->fnRegisterCallback(s->handle, (void*)eciCallback, nullptr);
-        dbg("worker: RegisterCallback returned %d", cbRc);
+        dbgInfo("worker: RegisterCallback(fn=%p)", (void*)eciCallback);
+        int cbRc = s->fnRegisterCallback(s->handle, (void*)eciCallback, s);
+        dbgInfo("worker: RegisterCallback returned %d", cbRc);
 
         // Set output buffer for callback audio delivery.
-        dbg("worker: 3.3 setup — SetOutputBuffer(%d samples, buf=%p)", s->kSamples, s->eciBuffer);
+        s->eciBuffer.assign((size_t)s->eciBufferSamples.value.load(std::memory_order_relaxed), 0);
+        dbgInfo("worker: 3.3 setup — SetOutputBuffer(%zu samples, buf=%p)",
+            s->eciBuffer.size(), (void*)s->eciBuffer.data());
         if (s->fnSetOutputBuffer) {
-            int obRc = s->fnSetOutputBuffer(s->handle, s->kSamples, s->eciBuffer);
-            dbg("worker: SetOutputBuffer returned %d", obRc);
+            int obRc = s->fnSetOutputBuffer(s->handle, (int)s->eciBuffer.size(), s->eciBuffer.data());
+            dbgInfo("worker: SetOutputBuffer returned %d", obRc);
         }
 
         // Synth mode: param 1, value 1 (to-buffer, not to speakers).
         int smRc = s->fnSetParam(s->handle, 1, 1);
-        dbg("worker: SetParam(1,1) [synth mode] returned %d", smRc);
+        dbgInfo("worker: SetParam(1,1) [synth mode] returned %d", smRc);
         // Verify it was actually set.
         if (s->fnGetParam) {
             int actual = s->fnGetParam(s->handle, 1);
-            dbg("worker: GetParam(1) = %d (expect 1 for buffer mode)", actual);
+            dbgInfo("worker: GetParam(1) = %d (expect 1 for buffer mode)", actual);
         }
 
         // Set known format: 11025 Hz, 16-bit, mono.
@@ -952,33 +4303,55 @@ static void workerLoop(ELOQ_STATE* s) {
         s->formatValid = true;
         s->bytesPerSec.store(22050, std::memory_order_relaxed);
 
+        // Silence trimming: cap at 60 ms of silence (same as 2.0).
+        s->maxSilenceSamples = s->lastFormat.nSamplesPerSec * 60 / 1000;
+
     } else { // ELOQ_MODE_20
-        dbg("worker: 2.0 setup — SetOutputDevice...");
+        dbgInfo("worker: 2.0 setup — SetOutputDevice...");
         // Set output device (optional, may fail).
         if (s->fnSetOutputDevice)
             s->fnSetOutputDevice(s->handle, 0);
 
-        dbg("worker: 2.0 SetParam(1,1)...");
+        dbgInfo("worker: 2.0 SetParam(1,1)...");
         // Synth mode: param 1, value 1.
         s->fnSetParam(s->handle, 1, 1);
 
         // Prime: add space, synthesize, poll, synchronize, stop.
         // This is required for 2.0 to initialize its internal state.
-        dbg("worker: 2.0 priming...");
+        dbgInfo("worker: 2.0 priming...");
+        ResetEvent(s->doneEvent);
         s->fnAddText(s->handle, " ");
-        dbg("worker: 2.0 fnSynthesize...");
+        dbgInfo("worker: 2.0 fnSynthesize...");
         s->fnSynthesize(s->handle);
-        dbg("worker: 2.0 waiting for speaking to finish...");
-        if (s->fnSpeaking) {
-            while (s->fnSpeaking(s->handle)) {
-                Sleep(5);
+        dbgInfo("worker: 2.0 waiting for speaking to finish...");
+        // The hooked waveOutReset/Close signals doneEvent when the engine
+        // is through; fnSpeaking is only consulted on wakeups, and as a
+        // fallback should the engine finish without touching waveOut.
+        {
+            const DWORD primeStart = GetTickCount();
+            while (s->fnSpeaking && s->fnSpeaking(s->handle)) {
+                const DWORD elapsed = GetTickCount() - primeStart;
+                if (elapsed >= 5000) {
+                    dbgError("worker: 2.0 priming did not finish in 5 s");
+                    break;
+                }
+                DWORD w = MsgWaitForMultipleObjectsEx(1, &s->doneEvent, 50,
+                    QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+                if (w == WAIT_OBJECT_0) break;
+                if (w == WAIT_OBJECT_0 + 1) {
+                    while (PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE)) {
+                        TranslateMessage(&msg);
+                        DispatchMessageW(&msg);
+                    }
+                }
             }
+            ResetEvent(s->doneEvent);
         }
-        dbg("worker: 2.0 speaking done, skipping fnSynchronize (crashes with hooked waveOut)");
+        dbgInfo("worker: 2.0 speaking done, skipping fnSynchronize (crashes with hooked waveOut)");
         s->fnStop(s->handle);
 
         // Register callback AFTER priming (2.0 requirement).
-        s->fnRegisterCallback(s->handle, (void*)eciCallback, nullptr);
+        s->fnRegisterCallback(s->handle, (void*)eciCallback, s);
     }
 
     // Read initial voice params.
@@ -986,6 +4359,7 @@ static void workerLoop(ELOQ_STATE* s) {
         for (int i = 1; i <= 7; i++) {
             int v = s->fnGetVoiceParam(s->handle, 0, i);
             s->vparams[i].value.store(v, std::memory_order_relaxed);
+            s->appliedVparams[i] = v;
         }
     }
     if (s->mode == ELOQ_MODE_33 && s->fnGetParam) {
@@ -993,14 +4367,22 @@ static void workerLoop(ELOQ_STATE* s) {
         s->voice.value.store(s->currentVoice, std::memory_order_relaxed);
     }
 
+    // Pre-create the sonic stream so the first boosted utterance does not
+    // pay for it (2.0's format is known once priming opened waveOut).
+    ensureSonicStream(s);
+
     s->initOk.store(1, std::memory_order_relaxed);
     if (s->initEvent) SetEvent(s->initEvent);
 
-    dbg("worker: init OK, mode=%d handle=%p genCounter=%u cancelToken=%u",
+    dbgInfo("worker: init OK, mode=%d handle=%p genCounter=%u cancelToken=%u",
         s->mode, s->handle,
         s->genCounter.load(std::memory_order_relaxed),
         s->cancelToken.load(std::memory_order_relaxed));
 
+    // Commands may already be queued: eloq_ready() is 1 from here on, and
+    // warm-up only fills the time until the first one.
+    warmUp(s);
+
     // ---- Main command loop ----
     auto pumpMessages = [&]() {
         while (PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE)) {
@@ -1014,17 +4396,31 @@ static void workerLoop(ELOQ_STATE* s) {
 
         Cmd cmd;
         bool hasCmd = false;
+        std::shared_ptr<DictLoad> dictLoad;
         {
             std::lock_guard<std::mutex> lk(s->cmdMtx);
-            if (!s->cmdQ.empty()) {
+            dictLoad.swap(s->pendingDict);
+            if (!s->urgentQ.empty()) {
+                cmd = std::move(s->urgentQ.front());
+                s->urgentQ.pop_front();
+                s->urgentPending.store((int)s->urgentQ.size(), std::memory_order_relaxed);
+                if (s->urgentQ.empty()) ResetEvent(s->preemptEvent);
+                hasCmd = true;
+            } else if (!s->cmdQ.empty()) {
                 cmd = std::move(s->cmdQ.front());
                 s->cmdQ.pop_front();
                 hasCmd = true;
-            } else {
+            } else if (!dictLoad) {
                 ResetEvent(s->cmdEvent);
             }
         }
 
+        // A new dictionary goes in here, between utterances.
+        if (dictLoad) {
+            swapDictionary(s, *dictLoad);
+            dictLoad.reset();
+        }
+
         if (!hasCmd) {
             MsgWaitForMultipleObjectsEx(
                 1,
@@ -1037,66 +4433,208 @@ static void workerLoop(ELOQ_STATE* s) {
         }
 
         if (cmd.type == Cmd::CMD_QUIT) {
-            dbg("worker: CMD_QUIT");
+            dbgInfo("worker: CMD_QUIT");
             break;
         }
 
+        // Urgent text sets aside what the reader has not heard yet, unless
+        // the reader is on urgent text itself; then it queues behind that.
+        if (cmd.urgent && cmd.cancelSnapshot == s->cancelToken.load(std::memory_order_relaxed)) {
+            suspendReaderOutput(s);
+            std::lock_guard<std::mutex> g(s->outMtx);
+            cmd.queued = isUrgentGen(s, s->currentGen.load(std::memory_order_relaxed));
+        }
+
+        // A queued command or render must not disturb a staged lookahead:
+        // wait until the reader promotes it (or a cancel drops it). Urgent
+        // text waiting for the engine goes first.
+        if (cmd.queued || cmd.render) {
+            bool yielded = false;
+            while (s->cancelToken.load(std::memory_order_relaxed) == cmd.cancelSnapshot) {
+                if (!cmd.urgent && s->urgentPending.load(std::memory_order_relaxed) > 0) {
+                    yielded = true;
+                    break;
+                }
+                {
+                    std::lock_guard<std::mutex> g(s->outMtx);
+                    if (!s->staged) break;
+                    ResetEvent(s->promoteEvent);
+                }
+                HANDLE waits[3] = { s->promoteEvent, s->stopEvent, s->preemptEvent };
+                MsgWaitForMultipleObjectsEx(cmd.urgent ? 2 : 3, waits, INFINITE, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+                pumpMessages();
+            }
+            if (yielded) {
+                std::vector<Cmd> cmds;
+                cmds.push_back(std::move(cmd));
+                requeueFront(s, cmds);
+                continue;
+            }
+        }
+
         // Check if this command was canceled before we process it.
         const uint32_t snap = s->cancelToken.load(std::memory_order_relaxed);
         dbg("worker: CMD_SPEAK snap=%u cmdSnap=%u text='%.80s'", snap, cmd.cancelSnapshot, cmd.text.c_str());
         if (cmd.cancelSnapshot != snap) {
             dbg("worker: command canceled (snap mismatch)");
+            if (cmd.render) renderComplete(cmd.render, -6);
             continue;
         }
 
         const uint32_t gen = s->genCounter.fetch_add(1, std::memory_order_relaxed);
         dbg("worker: gen=%u", gen);
+        if (cmd.urgent) {
+            s->urgentSlot ^= 1;
+            s->urgentGens[s->urgentSlot] = gen;
+        }
 
         ResetEvent(s->stopEvent);
         ResetEvent(s->doneEvent);
+        s->stopRequestUs.store(0, std::memory_order_relaxed);
         s->silenceSamples = 0;
-
-        // Gate on.
-        s->currentGen.store(gen, std::memory_order_relaxed);
-        s->activeGen.store(gen, std::memory_order_relaxed);
-
-        // Clear output queue.
+        // Drop anything a canceled utterance left inside sonic.
+        if (s->sonicStream) sonicResetStream(s->sonicStream);
+        s->sonicInFrames = s->sonicOutFrames = 0;
+        s->sonicMarkers.clear();
+
+        // Gate on. Renders and lookahead run as the side generation and
+        // leave the reader's queue alone; a queued command is staged while
+        // the previous utterance is still being drained. Anything else
+        // becomes the reader's generation right away.
+        RenderJob* job = cmd.render;
         {
             std::lock_guard<std::mutex> g(s->outMtx);
-            clearOutputQueueLocked(s);
+            const uint32_t curGen = s->currentGen.load(std::memory_order_relaxed);
+            const bool draining = curGen != 0 && s->outGen == curGen &&
+                (s->pcm.size() > 0 || !s->markers.empty());
+            if (job) {
+                s->sideGen.store(gen, std::memory_order_relaxed);
+            } else if (cmd.queued && draining) {
+                dbg("worker: staging gen=%u behind gen=%u", gen, curGen);
+                s->stagePcm.clear();
+                s->stageMarkers.clear();
+                s->staged = true;
+                s->sideGen.store(gen, std::memory_order_relaxed);
+            } else {
+                clearStageLocked(s);
+                s->currentGen.store(gen, std::memory_order_relaxed);
+                clearOutputQueueLocked(s);
+                s->outGen = gen;
+            }
         }
+        s->activeGen.store(gen, std::memory_order_relaxed);
 
         // Apply pending settings.
         applyDirtySettings(s);
 
+        // Offline render: route this generation to the job's sink.
+        if (job) {
+            job->startTick = GetTickCount();
+            job->started = true;
+            if (!renderOpen(job)) {
+                dbgError("worker: render output open FAILED (err=%lu)", GetLastError());
+                job->ioError = true;
+                finishGeneration(s, gen, job, false);
+                continue;
+            }
+            s->render = job;
+        }
+
+        // A resumed generation first replays what was already rendered.
+        if (cmd.resume) replayPhrase(s, gen, *cmd.resume);
+
         // Send text.
         if (cmd.text.empty()) {
             dbg("worker: empty text, pushing DONE");
-            s->activeGen.store(0, std::memory_order_relaxed);
-            pushMarker(s, ELOQ_ITEM_DONE, 0, gen);
+            finishGeneration(s, gen, job, false);
             continue;
         }
 
-        // Strip brackets/parens for all modes — Eloquence reads them as
-        // full words (e.g. "LEFT PAREN LEFT PARENTHESIS").
-        // Backtick only stripped for mode 20; mode 33 uses it as ECI
-        // inline command prefix (e.g. `da0, `vv92).
-        for (auto& ch : cmd.text) {
-            switch (ch) {
-                case '(': case ')':
-                case '{': case '}':
-                case '[': case ']':
-                    ch = ' ';
-                    break;
-                case '`':
-                    if (s->mode == ELOQ_MODE_20) ch = ' ';
-                    break;
+        // Rules file substitutions and the character map, in one pass.
+        // Resumed text went through it the first time.
+        if (!cmd.resume) {
+            std::shared_ptr<const RuleSet> rules;
+            {
+                std::lock_guard<std::mutex> lk(s->rulesMtx);
+                rules = s->rules;
+            }
+            if (rules) {
+                applyTextRules(*rules, s->charMap, s->voice.value.load(std::memory_order_relaxed),
+                    cmd.text, s->ruleText);
+                cmd.text.swap(s->ruleText);
+            } else {
+                for (auto& ch : cmd.text) ch = (char)s->charMap[(uint8_t)ch];
+            }
+        }
+
+        // Short utterances replay from the phrase cache without touching the
+        // engine; misses are captured and inserted once they complete.
+        const size_t cacheCap = (size_t)s->cacheMaxBytes.load(std::memory_order_relaxed);
+        std::string cacheKey;
+        if (cacheCap == 0) {
+            if (!s->phraseCache.lru.empty()) {
+                s->phraseCache.clear();
+                s->cacheEntries.store(0, std::memory_order_relaxed);
+                s->cacheBytes.store(0, std::memory_order_relaxed);
+            }
+        } else if (!cmd.resume && cmd.text.size() <= kPhraseCacheMaxText) {
+            s->phraseCache.trim(cacheCap);
+            cacheKey = settingsFingerprint(s);
+            cacheKey += cmd.text;
+            if (const PhraseEntry* e = s->phraseCache.find(cacheKey)) {
+                dbg("worker: phrase cache hit (%zu bytes)", e->pcm.size());
+                s->cacheHits.fetch_add(1, std::memory_order_relaxed);
+                replayPhrase(s, gen, *e);
+                finishGeneration(s, gen, job, false);
+                continue;
             }
+            s->cacheMisses.fetch_add(1, std::memory_order_relaxed);
+            s->capturePcm.clear();
+            s->captureMarkers.clear();
+            s->capturing = true;
         }
 
-        dbg("worker: fnAddText...");
-        int addRc = s->fnAddText(s->handle, cmd.text.c_str());
-        dbg("worker: fnAddText returned %d", addRc);
+        // Long text goes to the engine a chunk at a time, one chunk ahead of
+        // playback: the boundary index after chunk k fires when the engine
+        // starts on chunk k+1, which is when chunk k+2 is added.
+        const int chunkBytes = s->chunkBytes.load(std::memory_order_relaxed);
+        if (chunkBytes > 0 && cmd.text.size() > (size_t)chunkBytes && s->fnInsertIndex) {
+            splitTextChunks(cmd.text, (size_t)chunkBytes, s->textChunks);
+        } else {
+            s->textChunks.clear();
+            s->textChunks.push_back(std::move(cmd.text));
+        }
+        const size_t numChunks = s->textChunks.size();
+        size_t nextChunk = 0;
+        ResetEvent(s->chunkEvent);
+        // Normal-lane speech gives way to urgent text at a chunk boundary.
+        const bool preemptible = !job && !cmd.urgent;
+        if (preemptible) markResumeStart(s, gen);
+
+        unsigned inlineSent = 0;
+        auto feedChunk = [&]() {
+            if (nextChunk == 0 && !s->inlinePrefix.empty()) {
+                dbg("worker: fnAddText annotations '%s'", s->inlinePrefix.c_str());
+                s->fnAddText(s->handle, s->inlinePrefix.c_str());
+                inlineSent = s->inlineMask;
+                s->inlinePrefix.clear();
+                s->inlineMask = 0;
+            }
+            const std::string& chunk = s->textChunks[nextChunk];
+            dbg("worker: fnAddText chunk %zu/%zu (%zu bytes)...", nextChunk + 1, numChunks, chunk.size());
+            int addRc = s->fnAddText(s->handle, chunk.c_str());
+            dbg("worker: fnAddText returned %d", addRc);
+            if (nextChunk + 1 < numChunks)
+                s->fnInsertIndex(s->handle, kChunkIndexBase | (int)(nextChunk & kChunkIndexMask));
+            ++nextChunk;
+        };
+
+        s->utterAudioBytes.store(0, std::memory_order_relaxed);
+        s->throttleMs.store(0, std::memory_order_relaxed);
+        updateWatermarks(s);
+        const int64_t synthStartUs = nowUs();
+        feedChunk();
+        if (nextChunk < numChunks) feedChunk();
         dbg("worker: fnSynthesize...");
         int synRc = s->fnSynthesize(s->handle);
         dbg("worker: fnSynthesize returned %d", synRc);
@@ -1104,39 +4642,84 @@ static void workerLoop(ELOQ_STATE* s) {
         // Check output queue size after synthesis (for 3.3 synchronous mode).
         {
             std::lock_guard<std::mutex> g(s->outMtx);
-            dbg("worker: after synth outQ.size=%zu queuedBytes=%zu currentGen=%u",
-                s->outQ.size(), s->queuedAudioBytes,
+            dbg("worker: after synth markers=%zu queuedBytes=%zu currentGen=%u",
+                s->markers.size(), s->pcm.size(),
                 s->currentGen.load(std::memory_order_relaxed));
         }
 
         // Wait for synthesis to complete, pumping messages.
         // - 3.3: ECI callback delivers done via msg queue → doneEvent.
         // - 2.0: doneEvent set by hook_waveOutReset when engine finishes.
-        HANDLE waits[2] = { s->doneEvent, s->stopEvent };
+        // - chunkEvent: a chunk boundary was reached; feed the next chunk.
+        // - preemptEvent: urgent text is waiting (preemptible speech only).
+        HANDLE waits[4] = { s->doneEvent, s->stopEvent, s->chunkEvent, s->preemptEvent };
+        const DWORD numWaits = preemptible ? 4 : 3;
         bool stopped = false;
+        bool suspended = false;
 
-        const DWORD timeout = 120000; // 2 minutes max per utterance.
+        size_t fedBytes = 0;
+        for (size_t k = 0; k < nextChunk; k++) fedBytes += s->textChunks[k].size();
+        DWORD timeout = utteranceTimeout(s, fedBytes);
         DWORD deadline = GetTickCount() + timeout;
+        uint64_t heldMs = 0;
         bool waitDone = false;
         while (!waitDone) {
+            // A cancel via eloq_speak/eloq_stop also sets stopEvent, but the
+            // token is cheaper to check after every pump.
+            if (s->cancelToken.load(std::memory_order_relaxed) != snap) {
+                stopped = true;
+                break;
+            }
+            if (preemptible && s->urgentPending.load(std::memory_order_relaxed) > 0) {
+                dbg("worker: urgent text waiting, suspending gen=%u", gen);
+                stopped = suspended = true;
+                break;
+            }
+            // Time the engine spent held back by flow control is not
+            // synthesis time.
+            if (const uint32_t held = s->throttleMs.exchange(0, std::memory_order_relaxed)) {
+                deadline += held;
+                heldMs += held;
+            }
             DWORD remaining = deadline - GetTickCount();
             if ((int)remaining <= 0) {
-                dbg("worker: TIMEOUT waiting for synthesis");
+                dbgError("worker: TIMEOUT waiting for synthesis");
                 stopped = true;
                 break;
             }
             DWORD w = MsgWaitForMultipleObjectsEx(
-                2, waits, remaining, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
-            if (w == WAIT_OBJECT_0) {
-                dbg("worker: doneEvent signaled");
-                waitDone = true;
+                numWaits, waits, remaining, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+            if (w == WAIT_OBJECT_0 || w == WAIT_OBJECT_0 + 2) {
+                if (w == WAIT_OBJECT_0 && nextChunk >= numChunks) {
+                    dbg("worker: doneEvent signaled");
+                    waitDone = true;
+                } else if (nextChunk < numChunks) {
+                    // Boundary reached, or the engine drained its input
+                    // before we got to it: queue the next chunk.
+                    ResetEvent(waits[w - WAIT_OBJECT_0]);
+                    const size_t chunkLen = s->textChunks[nextChunk].size();
+                    feedChunk();
+                    s->fnSynthesize(s->handle);
+                    timeout = utteranceTimeout(s, chunkLen);
+                    deadline = GetTickCount() + timeout;
+                } else {
+                    ResetEvent(s->chunkEvent);
+                }
             } else if (w == WAIT_OBJECT_0 + 1) {
                 dbg("worker: stopEvent signaled");
                 stopped = true;
                 waitDone = true;
-            } else if (w == WAIT_OBJECT_0 + 2) {
-                // Messages available — pump them.
-                pumpMessages();
+            } else if (w == WAIT_OBJECT_0 + numWaits) {
+                // Messages available — pump them, bailing out on a cancel so
+                // a backlog of engine messages cannot delay the stop.
+                while (PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE)) {
+                    TranslateMessage(&msg);
+                    DispatchMessageW(&msg);
+                    if (s->cancelToken.load(std::memory_order_relaxed) != snap) break;
+                    if (preemptible && s->urgentPending.load(std::memory_order_relaxed) > 0) break;
+                }
+            } else if (w == WAIT_OBJECT_0 + 3) {
+                // preemptEvent: the check at the top of the loop suspends.
             } else {
                 dbg("worker: wait returned %lu", w);
                 stopped = true;
@@ -1144,31 +4727,68 @@ static void workerLoop(ELOQ_STATE* s) {
             }
         }
 
-        if (stopped || s->cancelToken.load(std::memory_order_relaxed) != snap) {
+        const bool preempted = stopped || s->cancelToken.load(std::memory_order_relaxed) != snap;
+        if (preempted) {
             dbg("worker: calling fnStop (stopped=%d)", stopped);
             if (s->fnStop) s->fnStop(s->handle);
+            // In-flight sonic output belongs to the canceled utterance.
+            if (s->sonicStream) sonicResetStream(s->sonicStream);
+            if (inlineSent) requeueInlineParams(s, inlineSent);
+            recordStopLatency(s);
+        }
+
+        // Real-time factor over the engine's own output (before trimming
+        // and rate boost). Time the engine was held back by flow control is
+        // waiting for the reader, not synthesis.
+        heldMs += s->throttleMs.exchange(0, std::memory_order_relaxed);
+        if (!preempted && s->formatValid && s->lastFormat.nAvgBytesPerSec > 0) {
+            const uint32_t bytes = s->utterAudioBytes.load(std::memory_order_relaxed);
+            const uint64_t audioUs = (uint64_t)bytes * 1000000 / s->lastFormat.nAvgBytesPerSec;
+            if (audioUs > 0) {
+                const uint64_t wallUs = (uint64_t)(nowUs() - synthStartUs);
+                const uint64_t synthUs = wallUs - std::min(wallUs, heldMs * 1000);
+                s->statRtfLast.store((uint32_t)std::min<uint64_t>(synthUs * 1000 / audioUs, UINT32_MAX),
+                    std::memory_order_relaxed);
+                s->statSynthUs.fetch_add(synthUs, std::memory_order_relaxed);
+                s->statAudioUs.fetch_add(audioUs, std::memory_order_relaxed);
+                s->statUtterances.fetch_add(1, std::memory_order_relaxed);
+            }
         }
 
         // Flush sonic stream to get any remaining buffered audio.
-        if (s->sonicStream && s->rateBoost > 1.001f && s->formatValid) {
+        if (!preempted && sonicActive(s)) {
             sonicFlushStream(s->sonicStream);
-            const int bps = s->lastFormat.wBitsPerSample;
-            const int nch = s->lastFormat.nChannels;
-            const int frameSize = (bps / 8) * nch;
-            int avail = sonicSamplesAvailable(s->sonicStream);
-            if (avail > 0 && frameSize > 0) {
-                std::vector<uint8_t> tail(avail * frameSize);
-                if (bps == 8)
-                    sonicReadUnsignedCharFromStream(s->sonicStream, tail.data(), avail);
-                else
-                    sonicReadShortFromStream(s->sonicStream, reinterpret_cast<short*>(tail.data()), avail);
-                pushAudioToQueue(s, gen, std::move(tail));
+            const size_t tail = sonicDrain(s);
+            if (tail > 0) pushSonicOutput(s, gen, s->sonicBuf.data(), tail);
+        }
+
+        const bool canceled = preempted;
+        if (s->capturing) {
+            // Only complete renders under unchanged settings are reusable.
+            s->capturing = false;
+            if (!canceled && cacheKey.compare(0, kFingerprintBytes, settingsFingerprint(s)) == 0) {
+                PhraseEntry e;
+                e.key = std::move(cacheKey);
+                e.pcm.assign(s->capturePcm.begin(), s->capturePcm.end());
+                e.markers = s->captureMarkers;
+                s->phraseCache.insert(std::move(e), cacheCap);
+                s->cacheEntries.store((uint32_t)s->phraseCache.lru.size(), std::memory_order_relaxed);
+                s->cacheBytes.store((uint32_t)s->phraseCache.bytes, std::memory_order_relaxed);
             }
         }
 
-        s->activeGen.store(0, std::memory_order_relaxed);
-        pushMarker(s, ELOQ_ITEM_DONE, 0, gen);
-        dbg("worker: pushed DONE marker, currentGen=%u", s->currentGen.load(std::memory_order_relaxed));
+        if (suspended && s->cancelToken.load(std::memory_order_relaxed) == snap) {
+            s->activeGen.store(0, std::memory_order_relaxed);
+            suspendGeneration(s, gen, cmd.cancelSnapshot, nextChunk);
+            continue;
+        }
+        finishGeneration(s, gen, job, canceled);
+    }
+
+    // Fail any render still queued so its caller returns.
+    {
+        std::lock_guard<std::mutex> lk(s->cmdMtx);
+        failQueuedRendersLocked(s);
     }
 
     // Cleanup.
@@ -1180,289 +4800,1297 @@ static void workerLoop(ELOQ_STATE* s) {
 }
 
 // ============================================================
-// Public API
+// Instances
 // ============================================================
-extern "C" ELOQ_API int __cdecl eloq_init(const wchar_t* dllDir) {
-    if (!dllDir) return -1;
-
-    dbg("eloq_init called");
-
-    std::lock_guard<std::mutex> glk(g_globalMtx);
-    if (g_state) { dbg("eloq_init: already initialized"); return 0; }
+// The global exports drive a default instance (g_state). eloq_create adds
+// further 3.3 instances, each with its own ECI handle, worker thread and
+// output queue, addressed by handle (slot + 1; 0 names the default).
+// 2.0 cannot be instanced: its audio is captured by process-wide waveOut
+// hooks that route to g_state, so only the default instance may be 2.0,
+// and then it must be the only instance.
+// All instance lifetime changes happen under g_globalMtx; as with
+// eloq_free, a handle must not be destroyed while other calls on it run.
+static const int kMaxInstances = 8;
+static ELOQ_STATE* g_instances[kMaxInstances] = {};
+static int g_liveInstances = 0; // default + pooled; keeps the trace flusher alive
+static std::atomic<int> g_warmUp{ 1 }; // eloq_set_warmup, read by createInstance
+
+static void closeInstanceEvents(ELOQ_STATE* s) {
+    if (s->doneEvent) CloseHandle(s->doneEvent);
+    if (s->stopEvent) CloseHandle(s->stopEvent);
+    if (s->cmdEvent) CloseHandle(s->cmdEvent);
+    if (s->initEvent) CloseHandle(s->initEvent);
+    if (s->dataEvent) CloseHandle(s->dataEvent);
+    if (s->chunkEvent) CloseHandle(s->chunkEvent);
+    if (s->promoteEvent) CloseHandle(s->promoteEvent);
+    if (s->drainEvent) CloseHandle(s->drainEvent);
+    if (s->preemptEvent) CloseHandle(s->preemptEvent);
+}
 
-    int mode = detectMode(dllDir);
-    dbg("eloq_init: mode=%d", mode);
-    if (mode == ELOQ_MODE_NONE) return -2;
+static void postQuit(ELOQ_STATE* s) {
+    std::lock_guard<std::mutex> lk(s->cmdMtx);
+    Cmd quit;
+    quit.type = Cmd::CMD_QUIT;
+    s->cmdQ.push_back(quit);
+    SetEvent(s->cmdEvent);
+}
 
+// Builds an instance, publishes it through *slot before its worker starts
+// (the 2.0 hooks look it up from the first waveOutOpen) and, if wait is
+// set, waits for the engine to come up. Returns 0, or -3 with *slot cleared
+// on failure. Without wait the instance is live immediately: commands queue
+// until the worker is ready, and initOk reports the outcome.
+// Caller holds g_globalMtx.
+static int createInstance(const wchar_t* dllDir, int mode, ELOQ_STATE** slot, bool wait) {
     ELOQ_STATE* s = new ELOQ_STATE();
     s->mode = mode;
     s->dllDir = dllDir;
+    s->mock = isMockDir(s->dllDir);
+    s->warmup = g_warmUp.load(std::memory_order_relaxed) != 0;
+    initCharMap(s->charMap, mode);
 
     s->doneEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
     s->stopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
     s->cmdEvent  = CreateEventW(nullptr, TRUE, FALSE, nullptr);
     s->initEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
-
-    g_state = s;
+    s->dataEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    s->chunkEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    s->promoteEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    s->drainEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    s->preemptEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+
+    // Preallocate the output ring and producer scratch up front.
+    s->pcm.init(s->maxBufferedBytes);
+    s->markers.init(s->maxQueueItems);
+    s->rateBoostPct.value.store(100, std::memory_order_relaxed);
+    s->eciBufferSamples.value.store(3300, std::memory_order_relaxed);
+    s->trimBuf.reserve(64 * 1024);
+    s->sonicBuf.reserve(64 * 1024);
+
+    *slot = s;
 
     s->worker = std::thread(workerLoop, s);
 
+    if (!wait) {
+        g_liveInstances++;
+        return 0;
+    }
+
     // Wait for init.
     WaitForSingleObject(s->initEvent, 10000);
 
     if (s->initOk.load(std::memory_order_relaxed) != 1) {
         // Init failed. Clean up.
         if (s->worker.joinable()) {
-            {
-                std::lock_guard<std::mutex> lk(s->cmdMtx);
-                Cmd quit;
-                quit.type = Cmd::CMD_QUIT;
-                s->cmdQ.push_back(quit);
-                SetEvent(s->cmdEvent);
-            }
+            postQuit(s);
             s->worker.join();
         }
-        if (s->doneEvent) CloseHandle(s->doneEvent);
-        if (s->stopEvent) CloseHandle(s->stopEvent);
-        if (s->cmdEvent) CloseHandle(s->cmdEvent);
-        if (s->initEvent) CloseHandle(s->initEvent);
+        disarmHooks(s);
+        closeInstanceEvents(s);
+        *slot = nullptr;
         delete s;
-        g_state = nullptr;
         return -3;
     }
 
+    g_liveInstances++;
+    return 0;
+}
+
+// Stops the worker and releases an instance published in *slot.
+// Caller holds g_globalMtx.
+static void destroyInstance(ELOQ_STATE** slot) {
+    ELOQ_STATE* s = *slot;
+
+    // Release any blocked eloq_read_wait caller, and a producer parked
+    // above high water or a command waiting on an unpromoted lookahead
+    // (the worker cannot reach the quit command past either).
+    s->shuttingDown.store(true, std::memory_order_relaxed);
+    s->cancelToken.fetch_add(1, std::memory_order_relaxed);
+    if (s->dataEvent) SetEvent(s->dataEvent);
+    if (s->drainEvent) SetEvent(s->drainEvent);
+    if (s->stopEvent) SetEvent(s->stopEvent);
+
+    // Send quit command.
+    postQuit(s);
+
+    if (s->worker.joinable()) {
+        s->worker.join();
+    }
+    disarmHooks(s);
+
+    if (s->sonicStream) {
+        sonicDestroyStream(s->sonicStream);
+        s->sonicStream = nullptr;
+    }
+
+    closeInstanceEvents(s);
+
+    *slot = nullptr;
+    delete s;
+
+    if (--g_liveInstances == 0)
+        traceStopFlusher();
+}
+
+// Maps an API handle to its instance (0 = default). Null if not live.
+static ELOQ_STATE* instanceFromHandle(int h) {
+    if (h == 0) return g_state;
+    if (h < 1 || h > kMaxInstances) return nullptr;
+    return g_instances[h - 1];
+}
+
+// ============================================================
+// Public API
+// ============================================================
+extern "C" ELOQ_API int __cdecl eloq_init(const wchar_t* dllDir) {
+    if (!dllDir) return -1;
+
+    std::lock_guard<std::mutex> glk(g_globalMtx);
+    traceStartFlusher();
+    dbgInfo("eloq_init called");
+    if (g_state) {
+        // Possibly still loading after eloq_init_async.
+        dbgInfo("eloq_init: already initialized");
+        WaitForSingleObject(g_state->initEvent, 10000);
+        return g_state->initOk.load(std::memory_order_relaxed) == 1 ? 0 : -3;
+    }
+
+    int mode = detectMode(dllDir);
+    dbgInfo("eloq_init: mode=%d", mode);
+    if (mode == ELOQ_MODE_NONE) {
+        if (g_liveInstances == 0) traceStopFlusher();
+        return -2;
+    }
+
+    // Both engines ship an ECI32D.DLL; a 2.0 default cannot share the
+    // process with loaded 3.3 instances.
+    if (mode == ELOQ_MODE_20 && g_liveInstances > 0) return -4;
+
+    int rc = createInstance(dllDir, mode, &g_state, true);
+    if (rc != 0 && g_liveInstances == 0) traceStopFlusher();
+    return rc;
+}
+
+// Starts loading the engine on the worker and returns at once. Speech and
+// settings calls made meanwhile are queued. Poll eloq_ready(); on failure
+// call eloq_free() before retrying. Returns 0, -1 or -2 as eloq_init.
+extern "C" ELOQ_API int __cdecl eloq_init_async(const wchar_t* dllDir) {
+    if (!dllDir) return -1;
+
+    std::lock_guard<std::mutex> glk(g_globalMtx);
+    traceStartFlusher();
+    dbgInfo("eloq_init_async called");
+    if (g_state) return 0;
+
+    int mode = detectMode(dllDir);
+    dbgInfo("eloq_init_async: mode=%d", mode);
+    if (mode == ELOQ_MODE_NONE) {
+        if (g_liveInstances == 0) traceStopFlusher();
+        return -2;
+    }
+    if (mode == ELOQ_MODE_20 && g_liveInstances > 0) return -4;
+
+    return createInstance(dllDir, mode, &g_state, false);
+}
+
+// 1 = engine ready, 0 = still loading, -1 = not initialized, -3 = failed.
+extern "C" ELOQ_API int __cdecl eloq_ready(void) {
+    ELOQ_STATE* s = g_state;
+    if (!s) return -1;
+    const int ok = s->initOk.load(std::memory_order_relaxed);
+    return ok == 1 ? 1 : ok == 0 ? 0 : -3;
+}
+
+// Warm-up after init: on (default) or off for instances created after the
+// call. An early speak still starts at once; it just meets a cold engine.
+extern "C" ELOQ_API int __cdecl eloq_set_warmup(int enable) {
+    g_warmUp.store(enable ? 1 : 0, std::memory_order_relaxed);
     return 0;
 }
 
+// ELOQ_READY_WARM / ELOQ_READY_COLD once the engine is up and warm-up has
+// ended, 0 while loading or warming, -1 if not initialized, -3 on failure.
+// A caller that wants a warm start waits for nonzero before its first speak.
+static int readyWarmInstance(ELOQ_STATE* s) {
+    if (!s) return -1;
+    const int ok = s->initOk.load(std::memory_order_relaxed);
+    if (ok != 1) return ok == 0 ? 0 : -3;
+    return s->warmState.load(std::memory_order_relaxed);
+}
+
+extern "C" ELOQ_API int __cdecl eloq_ready_warm(void) {
+    return readyWarmInstance(g_state);
+}
+
+extern "C" ELOQ_API int __cdecl eloq_ready_warm_h(int h) {
+    return readyWarmInstance(instanceFromHandle(h));
+}
+
 extern "C" ELOQ_API void __cdecl eloq_free(void) {
     std::lock_guard<std::mutex> glk(g_globalMtx);
+    if (!g_state) return;
+    destroyInstance(&g_state);
+}
+
+// Creates an additional engine instance from a 3.3 directory. Returns a
+// handle > 0, -1 on bad args, -2 if no engine was found, -3 if the engine
+// failed to start, -4 for a 2.0 directory or while the default instance is
+// 2.0 (not instanceable) and -5 when all slots are in use.
+extern "C" ELOQ_API int __cdecl eloq_create(const wchar_t* dllDir) {
+    if (!dllDir) return -1;
+
+    std::lock_guard<std::mutex> glk(g_globalMtx);
+    traceStartFlusher();
+    dbgInfo("eloq_create called");
+    int rc = -5;
+    int mode = detectMode(dllDir);
+    if (mode == ELOQ_MODE_NONE) {
+        rc = -2;
+    } else if (mode != ELOQ_MODE_33 || (g_state && g_state->mode != ELOQ_MODE_33)) {
+        rc = -4;
+    } else {
+        for (int i = 0; i < kMaxInstances; i++) {
+            if (g_instances[i]) continue;
+            rc = createInstance(dllDir, mode, &g_instances[i], true);
+            if (rc == 0) rc = i + 1;
+            break;
+        }
+    }
+    dbgInfo("eloq_create: mode=%d rc=%d", mode, rc);
+    if (rc < 0 && g_liveInstances == 0) traceStopFlusher();
+    return rc;
+}
+
+extern "C" ELOQ_API int __cdecl eloq_destroy(int h) {
+    std::lock_guard<std::mutex> glk(g_globalMtx);
+    if (h < 1 || h > kMaxInstances || !g_instances[h - 1]) return -1;
+    destroyInstance(&g_instances[h - 1]);
+    return 0;
+}
+
+extern "C" ELOQ_API int __cdecl eloq_version(void) {
     ELOQ_STATE* s = g_state;
-    if (!s) return;
+    return s ? s->mode : 0;
+}
+
+static int formatInstance(ELOQ_STATE* s, int* rate, int* bits, int* channels) {
+    if (!s || !s->formatValid) return -1;
+
+    const WAVEFORMATEX f = outputFormat(s);
+    if (rate) *rate = (int)f.nSamplesPerSec;
+    if (bits) *bits = (int)f.wBitsPerSample;
+    if (channels) *channels = (int)f.nChannels;
+    return 0;
+}
+
+extern "C" ELOQ_API int __cdecl eloq_format(int* rate, int* bits, int* channels) {
+    return formatInstance(g_state, rate, bits, channels);
+}
+
+extern "C" ELOQ_API int __cdecl eloq_format_h(int h, int* rate, int* bits, int* channels) {
+    return formatInstance(instanceFromHandle(h), rate, bits, channels);
+}
+
+static int speakInstance(ELOQ_STATE* s, const char* text) {
+    if (!s || !text) return -1;
+
+    dbg("eloq_speak: '%.80s'", text);
+
+    // Cancel any previous utterance, including a staged lookahead that
+    // the reader would otherwise promote at the old utterance's DONE.
+    const int64_t now = nowUs();
+    if (s->activeGen.load(std::memory_order_relaxed) != 0)
+        s->stopRequestUs.store(now, std::memory_order_relaxed);
+    s->speakRequestUs.store(now, std::memory_order_relaxed);
+    uint32_t newCancel = s->cancelToken.fetch_add(1, std::memory_order_relaxed) + 1;
+    SetEvent(s->stopEvent);
+    {
+        std::lock_guard<std::mutex> lk(s->outMtx);
+        clearStageLocked(s);
+    }
+    if (s->dataEvent) SetEvent(s->dataEvent);
+
+    // Enqueue.
+    Cmd cmd;
+    cmd.type = Cmd::CMD_SPEAK;
+    cmd.cancelSnapshot = s->cancelToken.load(std::memory_order_relaxed);
+    cmd.text = text;
+
+    dbg("eloq_speak: cancelToken=%u cmdSnap=%u", newCancel, cmd.cancelSnapshot);
 
-    // Send quit command.
     {
         std::lock_guard<std::mutex> lk(s->cmdMtx);
-        Cmd quit;
-        quit.type = Cmd::CMD_QUIT;
-        s->cmdQ.push_back(quit);
+        s->cmdQ.push_back(std::move(cmd));
         SetEvent(s->cmdEvent);
     }
+    return 0;
+}
 
-    if (s->worker.joinable()) {
-        s->worker.join();
+// Queues text to play after the current utterance without canceling it.
+// The worker synthesizes it as soon as the engine is free, staging the
+// audio until the reader consumes the current utterance's DONE.
+static int queueInstance(ELOQ_STATE* s, const char* text) {
+    if (!s || !text) return -1;
+
+    dbg("eloq_queue: '%.80s'", text);
+
+    Cmd cmd;
+    cmd.type = Cmd::CMD_SPEAK;
+    cmd.cancelSnapshot = s->cancelToken.load(std::memory_order_relaxed);
+    cmd.text = text;
+    cmd.queued = true;
+
+    {
+        std::lock_guard<std::mutex> lk(s->cmdMtx);
+        s->cmdQ.push_back(std::move(cmd));
+        SetEvent(s->cmdEvent);
     }
+    return 0;
+}
 
-    if (s->sonicStream) {
-        sonicDestroyStream(s->sonicStream);
-        s->sonicStream = nullptr;
+static int stopInstance(ELOQ_STATE* s) {
+    if (!s) return -1;
+
+    if (s->activeGen.load(std::memory_order_relaxed) != 0)
+        s->stopRequestUs.store(nowUs(), std::memory_order_relaxed);
+
+    s->cancelToken.fetch_add(1, std::memory_order_relaxed);
+    SetEvent(s->stopEvent);
+
+    // Clear command queues.
+    {
+        std::lock_guard<std::mutex> lk(s->cmdMtx);
+        failQueuedRendersLocked(s);
+        s->urgentQ.clear();
+        s->urgentPending.store(0, std::memory_order_relaxed);
+        if (s->preemptEvent) ResetEvent(s->preemptEvent);
     }
 
-    if (s->doneEvent) CloseHandle(s->doneEvent);
-    if (s->stopEvent) CloseHandle(s->stopEvent);
-    if (s->cmdEvent) CloseHandle(s->cmdEvent);
-    if (s->initEvent) CloseHandle(s->initEvent);
+    // Clear output queue and any staged lookahead.
+    {
+        std::lock_guard<std::mutex> lk(s->outMtx);
+        clearOutputQueueLocked(s);
+        clearStageLocked(s);
+    }
+
+    s->currentGen.store(0, std::memory_order_relaxed);
+    s->sideGen.store(0, std::memory_order_relaxed);
+    s->activeGen.store(0, std::memory_order_relaxed);
+    s->speakRequestUs.store(0, std::memory_order_relaxed);
+
+    // Wake any eloq_read_wait caller so it sees the cancel, and a
+    // throttled producer so the engine can be stopped.
+    if (s->dataEvent) SetEvent(s->dataEvent);
+    if (s->drainEvent) SetEvent(s->drainEvent);
+
+    return 0;
+}
+
+// Urgent lane: interrupts normal speech without canceling it. The
+// interrupted generation stops at once; once the urgent text is done it
+// resumes from its last chunk boundary with the audio already rendered.
+static int speakUrgentInstance(ELOQ_STATE* s, const char* text) {
+    if (!s || !text) return -1;
+
+    dbg("eloq_speak_ex: urgent '%.80s'", text);
+
+    const int64_t now = nowUs();
+    if (s->activeGen.load(std::memory_order_relaxed) != 0)
+        s->stopRequestUs.store(now, std::memory_order_relaxed);
+    s->speakRequestUs.store(now, std::memory_order_relaxed);
+
+    Cmd cmd;
+    cmd.type = Cmd::CMD_SPEAK;
+    cmd.cancelSnapshot = s->cancelToken.load(std::memory_order_relaxed);
+    cmd.text = text;
+    cmd.urgent = true;
+
+    {
+        std::lock_guard<std::mutex> lk(s->cmdMtx);
+        s->urgentQ.push_back(std::move(cmd));
+        s->urgentPending.store((int)s->urgentQ.size(), std::memory_order_relaxed);
+        SetEvent(s->preemptEvent);
+        SetEvent(s->cmdEvent);
+    }
+    return 0;
+}
+
+// Speaks text on a priority lane (ELOQ_PRIORITY_*). The normal lane is
+// eloq_speak, or eloq_queue with ELOQ_SPEAK_QUEUE. Returns 0, -1 without an
+// instance or text, -2 for an unknown priority.
+static int speakExInstance(ELOQ_STATE* s, const char* text, int priority, int flags) {
+    switch (priority) {
+    case ELOQ_PRIORITY_NORMAL:
+        return (flags & ELOQ_SPEAK_QUEUE) ? queueInstance(s, text) : speakInstance(s, text);
+    case ELOQ_PRIORITY_URGENT:
+        return speakUrgentInstance(s, text);
+    default:
+        return -2;
+    }
+}
+
+extern "C" ELOQ_API int __cdecl eloq_speak(const char* text) {
+    return speakInstance(g_state, text);
+}
+
+extern "C" ELOQ_API int __cdecl eloq_speak_ex(const char* text, int priority, int flags) {
+    return speakExInstance(g_state, text, priority, flags);
+}
 
-    g_state = nullptr;
-    delete s;
+extern "C" ELOQ_API int __cdecl eloq_speak_ex_h(int h, const char* text, int priority, int flags) {
+    return speakExInstance(instanceFromHandle(h), text, priority, flags);
 }
 
-extern "C" ELOQ_API int __cdecl eloq_version(void) {
-    ELOQ_STATE* s = g_state;
-    return s ? s->mode : 0;
+extern "C" ELOQ_API int __cdecl eloq_stop(void) {
+    return stopInstance(g_state);
 }
 
-extern "C" ELOQ_API int __cdecl eloq_format(int* rate, int* bits, int* channels) {
-    ELOQ_STATE* s = g_state;
-    if (!s || !s->formatValid) return -1;
+extern "C" ELOQ_API int __cdecl eloq_queue(const char* text) {
+    return queueInstance(g_state, text);
+}
 
-    if (rate) *rate = (int)s->lastFormat.nSamplesPerSec;
-    if (bits) *bits = (int)s->lastFormat.wBitsPerSample;
-    if (channels) *channels = (int)s->lastFormat.nChannels;
-    return 0;
+extern "C" ELOQ_API int __cdecl eloq_queue_h(int h, const char* text) {
+    return queueInstance(instanceFromHandle(h), text);
 }
 
-extern "C" ELOQ_API int __cdecl eloq_speak(const char* text) {
-    ELOQ_STATE* s = g_state;
-    if (!s || !text) return -1;
+extern "C" ELOQ_API int __cdecl eloq_speak_h(int h, const char* text) {
+    return speakInstance(instanceFromHandle(h), text);
+}
 
-    dbg("eloq_speak: '%.80s'", text);
+extern "C" ELOQ_API int __cdecl eloq_stop_h(int h) {
+    return stopInstance(instanceFromHandle(h));
+}
 
-    // Cancel any previous utterance.
-    uint32_t newCancel = s->cancelToken.fetch_add(1, std::memory_order_relaxed) + 1;
-    SetEvent(s->stopEvent);
+// Synthesizes text to completion on the instance's worker, either into a
+// WAV file at outPath or through cb (exactly one of the two), bypassing the
+// streaming queue. Queued behind pending speech rather than canceling it;
+// eloq_stop/eloq_speak abort it like any utterance. cb runs on the worker.
+// Returns 0, -1 on bad args, -3 if the engine failed to start or is not up
+// within 10 s, -6 if canceled or aborted by cb, -7 on an output file error.
+static int renderInstance(ELOQ_STATE* s, const char* text, const wchar_t* outPath,
+    ELOQ_RENDER_CB cb, void* user, ELOQ_RENDER_STATS* stats) {
+    if (stats) memset(stats, 0, sizeof(*stats));
+    if (!s || !text || (!outPath) == (!cb)) return -1;
+
+    // After eloq_init_async, a failed worker would never pick the job up.
+    // Bounded like eloq_init: an engine still loading after that is -3.
+    if (s->initOk.load(std::memory_order_relaxed) == 0)
+        WaitForSingleObject(s->initEvent, 10000);
+    if (s->initOk.load(std::memory_order_relaxed) != 1) return -3;
+
+    RenderJob job;
+    job.outPath = outPath;
+    job.cb = cb;
+    job.user = user;
+    job.doneEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!job.doneEvent) return -1;
+
+    dbg("eloq_render: '%.80s'", text);
 
-    // Enqueue.
     Cmd cmd;
     cmd.type = Cmd::CMD_SPEAK;
     cmd.cancelSnapshot = s->cancelToken.load(std::memory_order_relaxed);
     cmd.text = text;
-
-    dbg("eloq_speak: cancelToken=%u cmdSnap=%u", newCancel, cmd.cancelSnapshot);
-
+    cmd.render = &job;
     {
         std::lock_guard<std::mutex> lk(s->cmdMtx);
         s->cmdQ.push_back(std::move(cmd));
         SetEvent(s->cmdEvent);
     }
-    return 0;
+
+    WaitForSingleObject(job.doneEvent, INFINITE);
+    CloseHandle(job.doneEvent);
+
+    if (stats) {
+        const WAVEFORMATEX f = outputFormat(s);
+        stats->sampleRate = (int)f.nSamplesPerSec;
+        stats->bitsPerSample = f.wBitsPerSample;
+        stats->channels = f.nChannels;
+        stats->audioBytes = (unsigned int)job.dataBytes;
+        stats->audioMs = f.nAvgBytesPerSec ? (int)(job.dataBytes * 1000 / f.nAvgBytesPerSec) : 0;
+        // Canceled before the worker reached it: there is no start to measure from.
+        stats->firstAudioMs = job.started && job.gotAudio ? (int)(job.firstAudioTick - job.startTick) : -1;
+        stats->elapsedMs = job.started ? (int)(GetTickCount() - job.startTick) : -1;
+        stats->indexCount = job.indexCount;
+    }
+    dbgInfo("eloq_render: rc=%d bytes=%llu", job.result, (unsigned long long)job.dataBytes);
+    return job.result;
 }
 
-extern "C" ELOQ_API int __cdecl eloq_stop(void) {
-    ELOQ_STATE* s = g_state;
-    if (!s) return -1;
+extern "C" ELOQ_API int __cdecl eloq_render(const char* text, const wchar_t* outPath,
+    ELOQ_RENDER_CB cb, void* user, ELOQ_RENDER_STATS* stats) {
+    return renderInstance(g_state, text, outPath, cb, user, stats);
+}
 
-    s->cancelToken.fetch_add(1, std::memory_order_relaxed);
-    SetEvent(s->stopEvent);
+extern "C" ELOQ_API int __cdecl eloq_render_h(int h, const char* text, const wchar_t* outPath,
+    ELOQ_RENDER_CB cb, void* user, ELOQ_RENDER_STATS* stats) {
+    return renderInstance(instanceFromHandle(h), text, outPath, cb, user, stats);
+}
 
-    // Clear command queue.
-    {
-        std::lock_guard<std::mutex> lk(s->cmdMtx);
-        s->cmdQ.clear();
+// Pops one item (audio up to the next marker, or a due marker). Caller holds
+// outMtx and has already reset *itemType/*value to NONE/0.
+static int readItemLocked(ELOQ_STATE* s, void* buf, int maxBytes, int* itemType, int* value) {
+    const uint32_t curGen = s->currentGen.load(std::memory_order_relaxed);
+    if (curGen == 0) {
+        static int readZeroCount = 0;
+        if (readZeroCount++ < 5) dbg("eloq_read: currentGen=0, returning NONE");
+        clearOutputQueueLocked(s);
+        return 0;
     }
 
-    // Clear output queue.
-    {
-        std::lock_guard<std::mutex> lk(s->outMtx);
-        clearOutputQueueLocked(s);
+    // Drop stale items.
+    if (s->outGen != curGen) {
+        dropStaleOutputLocked(s);
+        s->outGen = curGen;
     }
 
-    s->currentGen.store(0, std::memory_order_relaxed);
-    s->activeGen.store(0, std::memory_order_relaxed);
+    // A marker is due once all audio pushed before it has been consumed.
+    if (!s->markers.empty() && s->markers.front().bytePos <= s->pcm.readPos) {
+        const StreamMarker& m = s->markers.front();
+        if (itemType) *itemType = m.type;
+        if (value) *value = m.value;
+        const bool done = (m.type == ELOQ_ITEM_DONE);
+        s->markers.pop();
+        if (done) promoteStagedLocked(s);
+        return 0;
+    }
 
-    return 0;
+    // Audio up to the next marker boundary.
+    size_t avail = s->pcm.size();
+    if (!s->markers.empty()) {
+        const size_t toMarker = (size_t)(s->markers.front().bytePos - s->pcm.readPos);
+        if (toMarker < avail) avail = toMarker;
+    }
+    if (avail == 0) return 0;
+
+    if (itemType) *itemType = ELOQ_ITEM_AUDIO;
+    int n = (avail > (size_t)maxBytes) ? maxBytes : (int)avail;
+    if (n > 0) {
+        gainReadLocked(s, (size_t)n);
+        s->pcm.copyOut(s->pcm.readPos, static_cast<uint8_t*>(buf), (size_t)n);
+        s->pcm.readPos += (uint64_t)n;
+        releaseProducerLocked(s);
+    }
+    return n;
 }
 
-extern "C" ELOQ_API int __cdecl eloq_read(void* buf, int maxBytes, int* itemType, int* value) {
+static int readInstance(ELOQ_STATE* s, void* buf, int maxBytes, int* itemType, int* value) {
     if (itemType) *itemType = ELOQ_ITEM_NONE;
     if (value) *value = 0;
 
-    ELOQ_STATE* s = g_state;
     if (!s || !buf || maxBytes < 0) return 0;
 
     std::lock_guard<std::mutex> g(s->outMtx);
+    return readItemLocked(s, buf, maxBytes, itemType, value);
+}
+
+extern "C" ELOQ_API int __cdecl eloq_read(void* buf, int maxBytes, int* itemType, int* value) {
+    return readInstance(g_state, buf, maxBytes, itemType, value);
+}
 
+extern "C" ELOQ_API int __cdecl eloq_read_h(int h, void* buf, int maxBytes, int* itemType, int* value) {
+    return readInstance(instanceFromHandle(h), buf, maxBytes, itemType, value);
+}
+
+// Sleeps on dataEvent for the rest of a read_wait/read_batch timeout.
+// Returns false once the timeout elapses or the utterance captured by
+// cancelSnap is canceled (eloq_stop or a new eloq_speak bumps cancelToken).
+// Caller reset dataEvent under outMtx after finding the queue empty.
+static bool waitForOutput(ELOQ_STATE* s, uint32_t cancelSnap, DWORD start, int timeoutMs) {
+    if (s->cancelToken.load(std::memory_order_relaxed) != cancelSnap) return false;
+
+    DWORD wait = INFINITE;
+    if (timeoutMs >= 0) {
+        DWORD elapsed = GetTickCount() - start;
+        if (elapsed >= (DWORD)timeoutMs) return false;
+        wait = (DWORD)timeoutMs - elapsed;
+    }
+    if (WaitForSingleObject(s->dataEvent, wait) != WAIT_OBJECT_0) return false;
+    return s->cancelToken.load(std::memory_order_relaxed) == cancelSnap;
+}
+
+// Blocking variant of eloq_read: sleeps on dataEvent until an item is
+// available, timeoutMs elapses, or the utterance is canceled. Returns like
+// eloq_read; NONE on timeout or cancel.
+static int readWaitInstance(ELOQ_STATE* s, void* buf, int maxBytes, int timeoutMs,
+    int* itemType, int* value) {
+    if (itemType) *itemType = ELOQ_ITEM_NONE;
+    if (value) *value = 0;
+
+    if (!s || !buf || maxBytes < 0) return 0;
+
+    const uint32_t cancelSnap = s->cancelToken.load(std::memory_order_relaxed);
+    const DWORD start = GetTickCount();
+    do {
+        std::lock_guard<std::mutex> g(s->outMtx);
+        int t = ELOQ_ITEM_NONE;
+        int v = 0;
+        int n = readItemLocked(s, buf, maxBytes, &t, &v);
+        if (t != ELOQ_ITEM_NONE) {
+            if (itemType) *itemType = t;
+            if (value) *value = v;
+            return n;
+        }
+        // Reset under outMtx: producers set the event under the same
+        // lock, so a publish cannot slip in between check and reset.
+        ResetEvent(s->dataEvent);
+    } while (waitForOutput(s, cancelSnap, start, timeoutMs));
+    return 0;
+}
+
+extern "C" ELOQ_API int __cdecl eloq_read_wait(void* buf, int maxBytes, int timeoutMs,
+    int* itemType, int* value) {
+    return readWaitInstance(g_state, buf, maxBytes, timeoutMs, itemType, value);
+}
+
+extern "C" ELOQ_API int __cdecl eloq_read_wait_h(int h, void* buf, int maxBytes, int timeoutMs,
+    int* itemType, int* value) {
+    return readWaitInstance(instanceFromHandle(h), buf, maxBytes, timeoutMs, itemType, value);
+}
+
+// Drains as much contiguous audio as fits into buf, recording every marker
+// crossed on the way with its byte offset into buf. Stops after DONE/ERROR
+// (end of a generation) or when the marker array is full. Fills markers or,
+// when that is null, markersEx. Without either (or with maxMarkers == 0)
+// markers are consumed and dropped, so the audio behind them stays
+// readable. Caller holds outMtx.
+static int readBatchLocked(ELOQ_STATE* s, uint8_t* buf, int maxBytes,
+    ELOQ_MARKER* markers, ELOQ_MARKER_EX* markersEx, int maxMarkers, int* numMarkers) {
     const uint32_t curGen = s->currentGen.load(std::memory_order_relaxed);
     if (curGen == 0) {
-        static int readZeroCount = 0;
-        if (readZeroCount++ < 5) dbg("eloq_read: currentGen=0, returning NONE");
         clearOutputQueueLocked(s);
         return 0;
     }
+    if (s->outGen != curGen) {
+        dropStaleOutputLocked(s);
+        s->outGen = curGen;
+    }
 
-    // Drop stale items.
-    while (!s->outQ.empty() && s->outQ.front().gen != curGen) {
-        StreamItem& it = s->outQ.front();
-        if (it.type == ELOQ_ITEM_AUDIO) {
-            size_t remaining = (it.data.size() > it.offset) ? (it.data.size() - it.offset) : 0;
-            if (s->queuedAudioBytes >= remaining) s->queuedAudioBytes -= remaining;
-            else s->queuedAudioBytes = 0;
+    const bool keep = (markers || markersEx) && maxMarkers > 0;
+    size_t n = 0;
+    int count = 0;
+    while (true) {
+        while (!s->markers.empty() && s->markers.front().bytePos <= s->pcm.readPos) {
+            if (keep && count >= maxMarkers) {
+                releaseProducerLocked(s);
+                *numMarkers = count;
+                return (int)n;
+            }
+            const StreamMarker& m = s->markers.front();
+            if (keep) {
+                if (markers) {
+                    markers[count].type = m.type;
+                    markers[count].value = m.value;
+                    markers[count].byteOffset = (int)n;
+                } else {
+                    markersEx[count].type = m.type;
+                    markersEx[count].value = m.value;
+                    markersEx[count].byteOffset = (int)n;
+                    markersEx[count].sampleOffset = m.frame;
+                }
+                count++;
+            }
+            // Without an array nobody sees the end, so the batch goes on.
+            const bool last = keep && (m.type == ELOQ_ITEM_DONE || m.type == ELOQ_ITEM_ERROR);
+            const bool done = (m.type == ELOQ_ITEM_DONE);
+            s->markers.pop();
+            if (done) promoteStagedLocked(s);
+            if (last) {
+                releaseProducerLocked(s);
+                *numMarkers = count;
+                return (int)n;
+            }
         }
-        s->outQ.pop_front();
+
+        size_t take = s->pcm.size();
+        if (!s->markers.empty()) {
+            const size_t toMarker = (size_t)(s->markers.front().bytePos - s->pcm.readPos);
+            if (toMarker < take) take = toMarker;
+        }
+        const size_t room = (size_t)maxBytes - n;
+        if (take > room) take = room;
+        if (take == 0) break;
+
+        gainReadLocked(s, take);
+        s->pcm.copyOut(s->pcm.readPos, buf + n, take);
+        s->pcm.readPos += take;
+        n += take;
     }
+    releaseProducerLocked(s);
+    *numMarkers = count;
+    return (int)n;
+}
 
-    if (s->outQ.empty()) return 0;
+static int readBatchWait(ELOQ_STATE* s, void* buf, int maxBytes, ELOQ_MARKER* markers,
+    ELOQ_MARKER_EX* markersEx, int maxMarkers, int* numMarkers, int timeoutMs) {
+    int localCount = 0;
+    if (!numMarkers) numMarkers = &localCount;
+    *numMarkers = 0;
+
+    if (!s || !buf || maxBytes < 0 || maxMarkers < 0) return 0;
+
+    const uint32_t cancelSnap = s->cancelToken.load(std::memory_order_relaxed);
+    const DWORD start = GetTickCount();
+    do {
+        std::lock_guard<std::mutex> g(s->outMtx);
+        int n = readBatchLocked(s, static_cast<uint8_t*>(buf), maxBytes, markers, markersEx,
+            maxMarkers, numMarkers);
+        if (n > 0 || *numMarkers > 0) return n;
+        ResetEvent(s->dataEvent);
+    } while (timeoutMs != 0 && waitForOutput(s, cancelSnap, start, timeoutMs));
+    return 0;
+}
 
-    StreamItem& front = s->outQ.front();
-    if (itemType) *itemType = front.type;
-    if (value) *value = front.value;
+// Batched read: one call returns up to maxBytes of audio plus the markers
+// that fall inside it (see ELOQ_MARKER). Blocks like eloq_read_wait until at
+// least one byte or marker is available; timeoutMs == 0 makes it non-blocking.
+// Returns the audio byte count; nothing ready is 0 bytes and 0 markers.
+extern "C" ELOQ_API int __cdecl eloq_read_batch(void* buf, int maxBytes,
+    ELOQ_MARKER* markers, int maxMarkers, int* numMarkers, int timeoutMs) {
+    return readBatchWait(g_state, buf, maxBytes, markers, nullptr, maxMarkers, numMarkers, timeoutMs);
+}
 
-    if (front.type == ELOQ_ITEM_AUDIO) {
-        size_t remainingSz = (front.data.size() > front.offset) ? (front.data.size() - front.offset) : 0;
-        int n = (remainingSz > (size_t)maxBytes) ? maxBytes : (int)remainingSz;
+extern "C" ELOQ_API int __cdecl eloq_read_batch_h(int h, void* buf, int maxBytes,
+    ELOQ_MARKER* markers, int maxMarkers, int* numMarkers, int timeoutMs) {
+    return readBatchWait(instanceFromHandle(h), buf, maxBytes, markers, nullptr, maxMarkers,
+        numMarkers, timeoutMs);
+}
 
-        if (n > 0) {
-            std::memcpy(buf, front.data.data() + front.offset, (size_t)n);
-            front.offset += (size_t)n;
-            if (s->queuedAudioBytes >= (size_t)n) s->queuedAudioBytes -= (size_t)n;
-            else s->queuedAudioBytes = 0;
-        }
+// eloq_read_batch with each marker's sample offset (see ELOQ_MARKER_EX).
+extern "C" ELOQ_API int __cdecl eloq_read_batch_ex(void* buf, int maxBytes,
+    ELOQ_MARKER_EX* markers, int maxMarkers, int* numMarkers, int timeoutMs) {
+    return readBatchWait(g_state, buf, maxBytes, nullptr, markers, maxMarkers, numMarkers, timeoutMs);
+}
 
-        if (front.offset >= front.data.size()) {
-            s->outQ.pop_front();
-        }
-        return n;
-    }
+extern "C" ELOQ_API int __cdecl eloq_read_batch_ex_h(int h, void* buf, int maxBytes,
+    ELOQ_MARKER_EX* markers, int maxMarkers, int* numMarkers, int timeoutMs) {
+    return readBatchWait(instanceFromHandle(h), buf, maxBytes, nullptr, markers, maxMarkers,
+        numMarkers, timeoutMs);
+}
 
-    // DONE / INDEX / ERROR: consume and return.
-    s->outQ.pop_front();
+static int setVariantInstance(ELOQ_STATE* s, int variant) {
+    if (!s) return -1;
+    storeSetting(s->variant, variant);
+    publishSettings(s);
     return 0;
 }
 
 extern "C" ELOQ_API int __cdecl eloq_set_variant(int variant) {
-    ELOQ_STATE* s = g_state;
-    if (!s) return -1;
-    s->variant.value.store(variant, std::memory_order_relaxed);
-    s->variant.dirty.store(1, std::memory_order_relaxed);
-    return 0;
+    return setVariantInstance(g_state, variant);
 }
 
-extern "C" ELOQ_API int __cdecl eloq_set_vparam(int param, int val) {
-    ELOQ_STATE* s = g_state;
+extern "C" ELOQ_API int __cdecl eloq_set_variant_h(int h, int variant) {
+    return setVariantInstance(instanceFromHandle(h), variant);
+}
+
+static int setVparamInstance(ELOQ_STATE* s, int param, int val) {
     if (!s || param < 1 || param > 7) return -1;
-    s->vparams[param].value.store(val, std::memory_order_relaxed);
-    s->vparams[param].dirty.store(1, std::memory_order_relaxed);
+    storeSetting(s->vparams[param], val);
+    publishSettings(s);
     return 0;
 }
 
-extern "C" ELOQ_API int __cdecl eloq_get_vparam(int param) {
-    ELOQ_STATE* s = g_state;
+extern "C" ELOQ_API int __cdecl eloq_set_vparam(int param, int val) {
+    return setVparamInstance(g_state, param, val);
+}
+
+extern "C" ELOQ_API int __cdecl eloq_set_vparam_h(int h, int param, int val) {
+    return setVparamInstance(instanceFromHandle(h), param, val);
+}
+
+static int getVparamInstance(ELOQ_STATE* s, int param) {
     if (!s || param < 1 || param > 7) return -1;
     return s->vparams[param].value.load(std::memory_order_relaxed);
 }
 
-extern "C" ELOQ_API int __cdecl eloq_set_voice(int voiceId) {
-    ELOQ_STATE* s = g_state;
+extern "C" ELOQ_API int __cdecl eloq_get_vparam(int param) {
+    return getVparamInstance(g_state, param);
+}
+
+extern "C" ELOQ_API int __cdecl eloq_get_vparam_h(int h, int param) {
+    return getVparamInstance(instanceFromHandle(h), param);
+}
+
+static int setVoiceInstance(ELOQ_STATE* s, int voiceId) {
     if (!s) return -1;
     if (s->mode != ELOQ_MODE_33) return 0; // no-op on 2.0
-    s->voice.value.store(voiceId, std::memory_order_relaxed);
-    s->voice.dirty.store(1, std::memory_order_relaxed);
+    storeSetting(s->voice, voiceId);
+    publishSettings(s);
     return 0;
 }
 
-extern "C" ELOQ_API int __cdecl eloq_set_rate_boost(int percent) {
-    ELOQ_STATE* s = g_state;
+extern "C" ELOQ_API int __cdecl eloq_set_voice(int voiceId) {
+    return setVoiceInstance(g_state, voiceId);
+}
+
+extern "C" ELOQ_API int __cdecl eloq_set_voice_h(int h, int voiceId) {
+    return setVoiceInstance(instanceFromHandle(h), voiceId);
+}
+
+static int setRateBoostInstance(ELOQ_STATE* s, int percent) {
     if (!s) return -1;
     if (percent < 100) percent = 100;
     if (percent > 600) percent = 600;
-    float newRate = (float)percent / 100.0f;
-    s->rateBoost = newRate;
-    // Update sonic stream speed if it exists.
-    if (s->sonicStream) {
-        if (newRate > 1.001f) {
-            sonicSetSpeed(s->sonicStream, newRate);
+    // Applied by the worker before the next utterance (applyDirtySettings),
+    // so the sonic stream is never touched from the caller's thread.
+    storeSetting(s->rateBoostPct, percent);
+    publishSettings(s);
+    dbgInfo("eloq_set_rate_boost: %d%%", percent);
+    return 0;
+}
+
+extern "C" ELOQ_API int __cdecl eloq_set_rate_boost(int percent) {
+    return setRateBoostInstance(g_state, percent);
+}
+
+extern "C" ELOQ_API int __cdecl eloq_set_rate_boost_h(int h, int percent) {
+    return setRateBoostInstance(instanceFromHandle(h), percent);
+}
+
+// Set several settings at once: ids[k] takes vals[k]. Ids 1-7 are the voice
+// params, the rest are ELOQ_PARAM_*. The batch is validated first and
+// published with a single version bump, so the worker applies it together
+// with one net-delta pass before the next utterance. Returns the number of
+// settings stored, or -1 (nothing stored) on a bad id.
+static int setParamsInstance(ELOQ_STATE* s, const int* ids, const int* vals, int n) {
+    if (!s || n < 0 || (n > 0 && (!ids || !vals))) return -1;
+    for (int k = 0; k < n; k++) {
+        const int id = ids[k];
+        if (!((id >= 1 && id <= 7) || id == ELOQ_PARAM_VARIANT || id == ELOQ_PARAM_VOICE ||
+              id == ELOQ_PARAM_RATE_BOOST || id == ELOQ_PARAM_INLINE || id == ELOQ_PARAM_GAIN))
+            return -1;
+    }
+    for (int k = 0; k < n; k++) {
+        const int id = ids[k];
+        const int v = vals[k];
+        if (id >= 1 && id <= 7) {
+            storeSetting(s->vparams[id], v);
+        } else if (id == ELOQ_PARAM_VARIANT) {
+            storeSetting(s->variant, v);
+        } else if (id == ELOQ_PARAM_VOICE) {
+            if (s->mode == ELOQ_MODE_33) storeSetting(s->voice, v);
+        } else if (id == ELOQ_PARAM_RATE_BOOST) {
+            storeSetting(s->rateBoostPct, std::max(100, std::min(v, 600)));
+        } else if (id == ELOQ_PARAM_GAIN) {
+            s->gainPct.store(std::max(0, std::min(v, 400)), std::memory_order_relaxed);
         } else {
-            // Boost disabled — destroy sonic stream.
-            sonicDestroyStream(s->sonicStream);
-            s->sonicStream = nullptr;
+            s->inlineParams.store(v ? 1 : 0, std::memory_order_relaxed);
         }
     }
-    dbg("eloq_set_rate_boost: %d%% (%.2f)", percent, newRate);
-    return 0;
+    if (n > 0) publishSettings(s);
+    dbg("eloq_set_params: %d settings", n);
+    return n;
+}
+
+extern "C" ELOQ_API int __cdecl eloq_set_params(const int* ids, const int* vals, int n) {
+    return setParamsInstance(g_state, ids, vals, n);
+}
+
+extern "C" ELOQ_API int __cdecl eloq_set_params_h(int h, const int* ids, const int* vals, int n) {
+    return setParamsInstance(instanceFromHandle(h), ids, vals, n);
 }
 
 extern "C" ELOQ_API int __cdecl eloq_get_rate_boost() {
     ELOQ_STATE* s = g_state;
     if (!s) return 100;
-    return (int)(s->rateBoost * 100.0f + 0.5f);
+    return s->rateBoostPct.value.load(std::memory_order_relaxed);
 }
 
-extern "C" ELOQ_API int __cdecl eloq_load_dict(const char* mainPath, const char* rootPath) {
+// Output gain in percent (0-400, 100 = unity). Applied to queued audio as
+// it is read, not through the engine's volume param, so it changes on the
+// next read and keeps full resolution; above unity the soft limiter keeps
+// peaks from clipping.
+static int setGainInstance(ELOQ_STATE* s, int percent) {
+    if (!s) return -1;
+    percent = std::max(0, std::min(percent, 400));
+    s->gainPct.store(percent, std::memory_order_relaxed);
+    dbgInfo("eloq_set_gain: %d%%", percent);
+    return 0;
+}
+
+extern "C" ELOQ_API int __cdecl eloq_set_gain(int percent) {
+    return setGainInstance(g_state, percent);
+}
+
+extern "C" ELOQ_API int __cdecl eloq_set_gain_h(int h, int percent) {
+    return setGainInstance(instanceFromHandle(h), percent);
+}
+
+extern "C" ELOQ_API int __cdecl eloq_get_gain() {
+    ELOQ_STATE* s = g_state;
+    if (!s) return 100;
+    return s->gainPct.load(std::memory_order_relaxed);
+}
+
+// 3.3 engine output buffer size in samples (128-32768, default 3300, i.e.
+// 300 ms at 11025 Hz). Takes effect before the next utterance. No-op on 2.0,
+// which plays through its own waveOut buffers.
+static int setOutputBufferInstance(ELOQ_STATE* s, int samples) {
+    if (!s || samples < 128 || samples > 32768) return -1;
+    if (s->mode != ELOQ_MODE_33) return 0;
+    storeSetting(s->eciBufferSamples, samples);
+    publishSettings(s);
+    return 0;
+}
+
+extern "C" ELOQ_API int __cdecl eloq_set_output_buffer(int samples) {
+    return setOutputBufferInstance(g_state, samples);
+}
+
+extern "C" ELOQ_API int __cdecl eloq_set_output_buffer_h(int h, int samples) {
+    return setOutputBufferInstance(instanceFromHandle(h), samples);
+}
+
+// PCM format delivered to clients: rate 8000-192000 Hz, bits 8, 16 or 32
+// (IEEE float); 0 keeps the engine's own value. Conversion shares the
+// rate-boost pass.
+// Takes effect before the next utterance; eloq_format reports the result
+// once it has.
+static int setOutputFormatInstance(ELOQ_STATE* s, int rate, int bits) {
+    if (!s) return -1;
+    if (rate != 0 && (rate < 8000 || rate > 192000)) return -1;
+    if (bits != 0 && bits != 8 && bits != 16 && bits != 32) return -1;
+    storeSetting(s->outRate, rate);
+    storeSetting(s->outBits, bits);
+    publishSettings(s);
+    dbgInfo("eloq_set_output_format: rate=%d bits=%d", rate, bits);
+    return 0;
+}
+
+extern "C" ELOQ_API int __cdecl eloq_set_output_format(int rate, int bits) {
+    return setOutputFormatInstance(g_state, rate, bits);
+}
+
+extern "C" ELOQ_API int __cdecl eloq_set_output_format_h(int h, int rate, int bits) {
+    return setOutputFormatInstance(instanceFromHandle(h), rate, bits);
+}
+
+// Set the text chunk size in bytes used to feed long utterances to the
+// engine (0 = disabled, otherwise clamped to 64..65536). Takes effect on
+// the next utterance.
+extern "C" ELOQ_API int __cdecl eloq_set_chunk_size(int bytes) {
     ELOQ_STATE* s = g_state;
+    if (!s) return -1;
+    if (bytes < 0) bytes = 0;
+    if (bytes > 0 && bytes < 64) bytes = 64;
+    if (bytes > 65536) bytes = 65536;
+    s->chunkBytes.store(bytes, std::memory_order_relaxed);
+    dbgInfo("eloq_set_chunk_size: %d", bytes);
+    return 0;
+}
+
+// Loads the main and root user dictionaries (3.3). A NULL path keeps that
+// volume's previous source; the rest of the old dictionary is replaced.
+// Sources are checked and their caches rebuilt if stale on the calling
+// thread; the worker swaps the new dictionary in before the next utterance
+// and the one in progress finishes with the old one. Returns 0, -1 if no
+// 3.3 instance, -2 if a source cannot be read.
+static int loadDictInstance(ELOQ_STATE* s, const char* mainPath, const char* rootPath) {
     if (!s || s->mode != ELOQ_MODE_33) return -1;
-    if (!s->fnNewDict || !s->fnSetDict || !s->fnLoadDict) return -1;
-    // Dict loading happens on any thread (ECI is tolerant for this).
-    // But we only do it once at init or on explicit call.
-    if (s->dictHandle < 0 && s->handle) {
-        s->dictHandle = s->fnNewDict(s->handle);
-        if (s->dictHandle >= 0)
-            s->fnSetDict(s->handle, s->dictHandle);
+    if (!s->fnNewDict || !s->fnSetDict || (!s->fnUpdateDict && !s->fnLoadDict)) return -1;
+
+    std::lock_guard<std::mutex> lk(s->dictMtx);
+    const std::string paths[2] = {
+        mainPath ? std::string(mainPath) : s->dictPaths[0],
+        rootPath ? std::string(rootPath) : s->dictPaths[1],
+    };
+    const int64_t t0 = nowUs();
+    auto load = std::make_shared<DictLoad>();
+    uint32_t skipped = 0, hits = 0;
+    for (int v = 0; v < 2; v++) {
+        if (paths[v].empty()) continue;
+        bool hit = false;
+        load->vol[v] = openDictCache(paths[v], &hit);
+        if (!load->vol[v]) {
+            dbgError("eloq_load_dict: cannot read '%s'", paths[v].c_str());
+            s->dictResult.store(-2, std::memory_order_relaxed);
+            return -2;
+        }
+        skipped += load->vol[v]->skippedLines;
+        if (hit) hits++;
+    }
+    const uint32_t us = (uint32_t)(nowUs() - t0);
+    s->dictPaths[0] = paths[0];
+    s->dictPaths[1] = paths[1];
+    s->dictSkipped.store(skipped, std::memory_order_relaxed);
+    s->dictCacheHits.fetch_add(hits, std::memory_order_relaxed);
+    s->dictParseUs.store(us, std::memory_order_relaxed);
+    s->dictResult.store(1, std::memory_order_relaxed);
+    dbgInfo("eloq_load_dict: main=%u root=%u entries, %u skipped lines, %u/%d from cache, %u us",
+        load->vol[0] ? load->vol[0]->entries : 0, load->vol[1] ? load->vol[1]->entries : 0,
+        skipped, hits, (load->vol[0] ? 1 : 0) + (load->vol[1] ? 1 : 0), us);
+    {
+        std::lock_guard<std::mutex> g(s->cmdMtx);
+        s->pendingDict = std::move(load);
+        SetEvent(s->cmdEvent);
+    }
+    return 0;
+}
+
+extern "C" ELOQ_API int __cdecl eloq_load_dict(const char* mainPath, const char* rootPath) {
+    return loadDictInstance(g_state, mainPath, rootPath);
+}
+
+extern "C" ELOQ_API int __cdecl eloq_load_dict_h(int h, const char* mainPath, const char* rootPath) {
+    return loadDictInstance(instanceFromHandle(h), mainPath, rootPath);
+}
+
+static int getDictStatsInstance(ELOQ_STATE* s, ELOQ_DICT_STATS* st) {
+    if (!s || !st) return -1;
+    st->result = s->dictResult.load(std::memory_order_relaxed);
+    st->loads = s->dictLoads.load(std::memory_order_relaxed);
+    st->mainEntries = s->dictMainEntries.load(std::memory_order_relaxed);
+    st->rootEntries = s->dictRootEntries.load(std::memory_order_relaxed);
+    st->skippedLines = s->dictSkipped.load(std::memory_order_relaxed);
+    st->rejected = s->dictRejected.load(std::memory_order_relaxed);
+    st->cacheHits = s->dictCacheHits.load(std::memory_order_relaxed);
+    st->parseUs = s->dictParseUs.load(std::memory_order_relaxed);
+    st->loadUs = s->dictLoadUs.load(std::memory_order_relaxed);
+    return 0;
+}
+
+extern "C" ELOQ_API int __cdecl eloq_get_dict_stats(ELOQ_DICT_STATS* st) {
+    return getDictStatsInstance(g_state, st);
+}
+
+extern "C" ELOQ_API int __cdecl eloq_get_dict_stats_h(int h, ELOQ_DICT_STATS* st) {
+    return getDictStatsInstance(instanceFromHandle(h), st);
+}
+
+// Per-utterance synthesis timeout: baseMs plus perByteMs for every byte of
+// text handed to the engine (per chunk when chunking), capped at 10 min.
+extern "C" ELOQ_API int __cdecl eloq_set_timeout(int baseMs, int perByteMs) {
+    ELOQ_STATE* s = g_state;
+    if (!s) return -1;
+    if (baseMs < 1000) baseMs = 1000;
+    if (baseMs > 600000) baseMs = 600000;
+    if (perByteMs < 0) perByteMs = 0;
+    if (perByteMs > 1000) perByteMs = 1000;
+    s->timeoutBaseMs.store(baseMs, std::memory_order_relaxed);
+    s->timeoutPerByteMs.store(perByteMs, std::memory_order_relaxed);
+    return 0;
+}
+
+// Flow control: once more than highMs of audio is queued for the reader the
+// engine is held back until it drains to lowMs. highMs 0 turns it off;
+// otherwise 500-600000, lowMs clamped to 0..highMs. Defaults 10000/5000.
+// Takes effect on the next utterance.
+static int setWatermarksInstance(ELOQ_STATE* s, int highMs, int lowMs) {
+    if (!s || highMs < 0) return -1;
+    if (highMs > 0) highMs = std::max(500, std::min(highMs, 600000));
+    lowMs = std::max(0, std::min(lowMs, highMs));
+    s->highWaterMs.store(highMs, std::memory_order_relaxed);
+    s->lowWaterMs.store(lowMs, std::memory_order_relaxed);
+    dbgInfo("eloq_set_watermarks: high=%d low=%d", highMs, lowMs);
+    return 0;
+}
+
+extern "C" ELOQ_API int __cdecl eloq_set_watermarks(int highMs, int lowMs) {
+    return setWatermarksInstance(g_state, highMs, lowMs);
+}
+
+extern "C" ELOQ_API int __cdecl eloq_set_watermarks_h(int h, int highMs, int lowMs) {
+    return setWatermarksInstance(instanceFromHandle(h), highMs, lowMs);
+}
+
+// Loads a rules file (format under "Text rules") in place of the current
+// rules; NULL or "" removes them. Compiled on the calling thread and swapped
+// in whole, so it is safe while speaking: the current utterance finishes
+// with the rules it started with. Returns the rule count, -2 if the file
+// cannot be read, -3 on a syntax error (line number in the trace). The
+// previous rules stay loaded on failure.
+static int loadRulesInstance(ELOQ_STATE* s, const wchar_t* path) {
+    if (!s) return -1;
+    std::shared_ptr<const RuleSet> rules;
+    int count = 0;
+    if (path && *path) {
+        count = compileRulesFile(path, &rules);
+        if (count < 0) return count;
+    }
+    std::lock_guard<std::mutex> lk(s->rulesMtx);
+    s->rules.swap(rules);
+    return count;
+}
+
+extern "C" ELOQ_API int __cdecl eloq_load_rules(const wchar_t* path) {
+    return loadRulesInstance(g_state, path);
+}
+
+extern "C" ELOQ_API int __cdecl eloq_load_rules_h(int h, const wchar_t* path) {
+    return loadRulesInstance(instanceFromHandle(h), path);
+}
+
+// Stop latency: eloq_stop/eloq_speak call to engine stopped and its
+// pending output dropped. Microseconds; any pointer may be null.
+extern "C" ELOQ_API int __cdecl eloq_get_stop_latency(int* lastUs, int* maxUs, int* count) {
+    ELOQ_STATE* s = g_state;
+    if (!s) return -1;
+    if (lastUs) *lastUs = (int)s->stopLatency.lastUs.load(std::memory_order_relaxed);
+    if (maxUs) *maxUs = (int)s->stopLatency.maxUs.load(std::memory_order_relaxed);
+    if (count) *count = (int)s->stopLatency.count.load(std::memory_order_relaxed);
+    return 0;
+}
+
+static int getStatsInstance(ELOQ_STATE* s, ELOQ_STATS* st) {
+    if (!s || !st) return -1;
+    memset(st, 0, sizeof(*st));
+    s->firstAudioLatency.read(st->firstAudio);
+    s->stopLatency.read(st->stop);
+    st->utterances = s->statUtterances.load(std::memory_order_relaxed);
+    st->rtfLastPermille = s->statRtfLast.load(std::memory_order_relaxed);
+    const uint64_t audioUs = s->statAudioUs.load(std::memory_order_relaxed);
+    if (audioUs)
+        st->rtfAvgPermille = (unsigned int)(s->statSynthUs.load(std::memory_order_relaxed) * 1000 / audioUs);
+    st->sonicBuffers = s->statSonicBuffers.load(std::memory_order_relaxed);
+    if (st->sonicBuffers)
+        st->sonicAvgUs = (unsigned int)(s->statSonicUs.load(std::memory_order_relaxed) / st->sonicBuffers);
+    st->sonicMaxUs = s->statSonicMaxUs.load(std::memory_order_relaxed);
+    st->queuedBytesPeak = s->statQueuedPeak.load(std::memory_order_relaxed);
+    st->queuedBytesCap = (unsigned int)s->maxBufferedBytes;
+    st->markersPeak = s->statMarkersPeak.load(std::memory_order_relaxed);
+    st->droppedBuffers = s->statDroppedBuffers.load(std::memory_order_relaxed);
+    st->droppedMarkers = s->statDroppedMarkers.load(std::memory_order_relaxed);
+    st->droppedBytes = s->statDroppedBytes.load(std::memory_order_relaxed);
+    st->overrunBytes = s->statOverrunBytes.load(std::memory_order_relaxed);
+    st->trimmedBytes = s->statTrimmedBytes.load(std::memory_order_relaxed);
+    st->synthUs = s->statSynthUs.load(std::memory_order_relaxed);
+    st->audioUs = audioUs;
+    return 0;
+}
+
+// Snapshot of the runtime statistics (see ELOQ_STATS). Lock-free; counters
+// are read one by one, so a snapshot taken mid-utterance may be slightly
+// inconsistent across fields.
+extern "C" ELOQ_API int __cdecl eloq_get_stats(ELOQ_STATS* st) {
+    return getStatsInstance(g_state, st);
+}
+
+extern "C" ELOQ_API int __cdecl eloq_get_stats_h(int h, ELOQ_STATS* st) {
+    return getStatsInstance(instanceFromHandle(h), st);
+}
+
+// Fills buf with speech-like synthetic PCM: 400 ms of a decaying harmonic
+// tone followed by 250 ms of digital silence, continuing from sample t.
+static void benchSynthPcm(int16_t* buf, size_t n, uint64_t& t, int rate) {
+    const uint64_t voiced = (uint64_t)rate * 400 / 1000;
+    const uint64_t period = voiced + (uint64_t)rate * 250 / 1000;
+    for (size_t i = 0; i < n; i++, t++) {
+        const uint64_t ph = t % period;
+        if (ph >= voiced) { buf[i] = 0; continue; }
+        const double x = (double)t / rate;
+        const double env = 1.0 - (double)ph / voiced;
+        const double w = x * 2 * 3.14159265;
+        const double v = std::sin(w * 140) * 0.6 + std::sin(w * 420) * 0.3 + std::sin(w * 980) * 0.1;
+        buf[i] = (int16_t)(v * env * 12000);
+    }
+}
+
+// Runs the non-engine stages on a private state with no engine or worker:
+// trimStage, sonicStage, pushAudioToQueue and readBatchLocked (with its
+// gain stage), exactly as the live path uses them. An index marker follows every buffer.
+extern "C" ELOQ_API int __cdecl eloq_bench_stages(ELOQ_STAGE_BENCH* b) {
+    if (!b || b->sampleRate < 8000 || b->bufferBytes < 2 || b->audioMs <= 0) return -1;
+    const int rate = b->sampleRate;
+    const size_t bufBytes = (size_t)b->bufferBytes & ~(size_t)1;
+
+    ELOQ_STATE* s = new ELOQ_STATE();
+    s->mode = ELOQ_MODE_33;
+    s->lastFormat.wFormatTag = WAVE_FORMAT_PCM;
+    s->lastFormat.nChannels = 1;
+    s->lastFormat.nSamplesPerSec = (DWORD)rate;
+    s->lastFormat.wBitsPerSample = 16;
+    s->lastFormat.nBlockAlign = 2;
+    s->lastFormat.nAvgBytesPerSec = (DWORD)rate * 2;
+    s->formatValid = true;
+    s->maxSilenceSamples = (uint32_t)rate * 60 / 1000;
+    s->rateBoost = (float)std::max(100, std::min(b->rateBoostPct, 600)) / 100.0f;
+    ensureSonicStream(s);
+    s->pcm.init(s->maxBufferedBytes);
+    s->markers.init(s->maxQueueItems);
+    s->currentGen.store(1, std::memory_order_relaxed);
+    s->activeGen.store(1, std::memory_order_relaxed);
+    s->outGen = 1;
+    s->gainPct.store(b->gainPct > 0 ? std::min(b->gainPct, 400) : 150, std::memory_order_relaxed);
+
+    std::vector<int16_t> in(bufBytes / 2);
+    std::vector<uint8_t> out(64 * 1024);
+    ELOQ_MARKER marks[64];
+    const uint64_t totalSamples = (uint64_t)rate * b->audioMs / 1000;
+    uint64_t t = 0;
+    int64_t trimUs = 0, sonicUs = 0, pushUs = 0, popUs = 0;
+    b->inBytes = b->outBytes = 0;
+
+    while (t < totalSamples) {
+        const size_t n = (size_t)std::min<uint64_t>(in.size(), totalSamples - t);
+        benchSynthPcm(in.data(), n, t, rate);
+        b->inBytes += n * 2;
+
+        const int64_t t0 = nowUs();
+        const uint8_t* p = nullptr;
+        size_t sz = trimStage(s, reinterpret_cast<const uint8_t*>(in.data()), n * 2, &p);
+        const int64_t t1 = nowUs();
+        if (sz) sz = sonicStage(s, p, sz, &p);
+        const int64_t t2 = nowUs();
+        if (sz) pushSonicOutput(s, 1, p, sz);
+        pushMarker(s, ELOQ_ITEM_INDEX, (int)(t & 0x7FFFFFFF), 1);
+        const int64_t t3 = nowUs();
+        trimUs += t1 - t0;
+        sonicUs += t2 - t1;
+        pushUs += t3 - t2;
+
+        for (;;) {
+            std::lock_guard<std::mutex> g(s->outMtx);
+            int numMarks = 0;
+            const int got = readBatchLocked(s, out.data(), (int)out.size(), marks, nullptr, 64, &numMarks);
+            if (got == 0 && numMarks == 0) break;
+            b->outBytes += (unsigned)got;
+        }
+        popUs += nowUs() - t3;
     }
-    if (s->dictHandle < 0) return -1;
 
-    if (mainPath)
-        s->fnLoadDict(s->handle, s->dictHandle, 0, mainPath);
-    if (rootPath)
-        s->fnLoadDict(s->handle, s->dictHandle, 1, rootPath);
+    b->trimmedBytes = s->statTrimmedBytes.load(std::memory_order_relaxed);
+    b->trimUs = (unsigned int)trimUs;
+    b->sonicUs = (unsigned int)sonicUs;
+    b->pushUs = (unsigned int)pushUs;
+    b->popUs = (unsigned int)(popUs - (int64_t)s->gainUs);
+    b->gainUs = (unsigned int)s->gainUs;
+
+    if (s->sonicStream) sonicDestroyStream(s->sonicStream);
+    delete s;
+    return 0;
+}
+
+// Phrase cache memory cap in bytes (0 disables and frees the cache on the
+// next utterance). Utterances up to 256 bytes of text whose audio fits in a
+// quarter of the cap are cached.
+extern "C" ELOQ_API int __cdecl eloq_set_cache_size(int bytes) {
+    ELOQ_STATE* s = g_state;
+    if (!s) return -1;
+    if (bytes < 0) bytes = 0;
+    s->cacheMaxBytes.store(bytes, std::memory_order_relaxed);
+    return 0;
+}
 
+// Phrase cache counters; any pointer may be null.
+extern "C" ELOQ_API int __cdecl eloq_get_cache_stats(int* hits, int* misses, int* entries, int* bytes) {
+    ELOQ_STATE* s = g_state;
+    if (!s) return -1;
+    if (hits) *hits = (int)s->cacheHits.load(std::memory_order_relaxed);
+    if (misses) *misses = (int)s->cacheMisses.load(std::memory_order_relaxed);
+    if (entries) *entries = (int)s->cacheEntries.load(std::memory_order_relaxed);
+    if (bytes) *bytes = (int)s->cacheBytes.load(std::memory_order_relaxed);
     return 0;
 }
+
+// Runtime trace level (ELOQ_LOG_OFF..ELOQ_LOG_DEBUG). Returns the previous
+// level. Levels above ELOQ_LOG_COMPILE_LEVEL are compiled out regardless.
+extern "C" ELOQ_API int __cdecl eloq_set_log_level(int level) {
+    if (level < ELOQ_LOG_OFF) level = ELOQ_LOG_OFF;
+    if (level > ELOQ_LOG_DEBUG) level = ELOQ_LOG_DEBUG;
+    return g_logLevel.exchange(level, std::memory_order_relaxed);
+}
+
+// Formats and writes all pending trace records now. Returns the count.
+extern "C" ELOQ_API int __cdecl eloq_dump_trace(void) {
+    return traceFlush();
+}
@@ -0,0 +1,418 @@
+// eloq_client.cpp
+//
+// Thin client for eloq_host.exe, for processes that cannot load the 32-bit
+// wrapper themselves (64-bit NVDA). It starts one host per process, maps its
+// shared-memory rings (eloq_shm.h), and exposes the wrapper's speech calls
+// with the same signatures under an eloqc_ prefix. eloqc_read_batch behaves
+// like eloq_read_batch and copies audio once, from the ring into the
+// caller's buffer; there is no per-chunk IPC.
+//
+// Speak/stop are tagged with an epoch. The host places an EPOCH marker in
+// the stream when it starts the new utterance, and the reader skips anything
+// in front of the marker for the current epoch, so a stop is immediate on
+// the client side even though the host drains asynchronously.
+//
+// Threading: speech and settings calls may come from any thread;
+// eloqc_read_batch must be called from a single reader thread.
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+#include "eloq_shm.h"
+
+// ------------------------------------------------------------
+// Public ABI (mirrors eloquence_wrapper.cpp)
+// ------------------------------------------------------------
+#define ELOQC_API __declspec(dllexport)
+
+#define ELOQ_ITEM_DONE  3
+#define ELOQ_ITEM_ERROR 4
+
+struct ELOQ_MARKER {
+    int type;
+    int value;
+    int byteOffset;
+};
+
+// Client-side eloqc_open failures; eloq_init codes pass through unchanged.
+#define ELOQC_ERR_SHM     (-11) // section or events could not be created
+#define ELOQC_ERR_SPAWN   (-12) // eloq_host.exe could not be started
+#define ELOQC_ERR_TIMEOUT (-13) // host neither became ready nor failed in time
+
+// ------------------------------------------------------------
+// Connection state (one host per process)
+// ------------------------------------------------------------
+struct Client {
+    std::mutex mtx; // open/close and the command ring
+    EloqShmHeader* hdr = nullptr;
+    HANDLE section = nullptr;
+    HANDLE cmdEvent = nullptr;
+    HANDLE dataEvent = nullptr;
+    HANDLE spaceEvent = nullptr;
+    HANDLE process = nullptr;
+    uint64_t cmdWrite = 0;
+
+    std::atomic<uint32_t> epoch{0};
+    std::atomic<bool> hostLost{false};
+
+    // Reader thread only.
+    uint64_t audioRead = 0;
+    uint64_t markerRead = 0;
+    uint32_t seenEpoch = 0;
+    bool lostReported = false;
+};
+
+static Client g_client;
+
+static std::wstring clientDir() {
+    HMODULE self = nullptr;
+    GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+        reinterpret_cast<LPCWSTR>(&g_client), &self);
+    wchar_t path[MAX_PATH];
+    DWORD n = GetModuleFileNameW(self, path, MAX_PATH);
+    std::wstring p(path, n);
+    const size_t slash = p.find_last_of(L"\\/");
+    return (slash == std::wstring::npos) ? std::wstring() : p.substr(0, slash + 1);
+}
+
+static void closeHandles(Client& c) {
+    if (c.hdr) UnmapViewOfFile(c.hdr);
+    for (HANDLE* h : { &c.section, &c.cmdEvent, &c.dataEvent, &c.spaceEvent, &c.process }) {
+        if (*h) CloseHandle(*h);
+        *h = nullptr;
+    }
+    c.hdr = nullptr;
+    c.cmdWrite = 0;
+    c.audioRead = 0;
+    c.markerRead = 0;
+    c.seenEpoch = 0;
+    c.epoch.store(0);
+    c.hostLost.store(false);
+    c.lostReported = false;
+}
+
+static bool hostAlive(Client& c) {
+    if (c.hostLost.load(std::memory_order_relaxed)) return false;
+    if (WaitForSingleObject(c.process, 0) == WAIT_OBJECT_0) {
+        c.hostLost.store(true, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+// Appends one command record. Caller holds mtx. Waits up to 2 s for the
+// host to make room.
+static int postCommand(Client& c, uint32_t type, int32_t arg, uint32_t count,
+    const void* p1, size_t n1, const void* p2 = nullptr, size_t n2 = 0) {
+    if (!c.hdr || !hostAlive(c)) return -1;
+    const size_t raw = sizeof(EloqShmCmd) + n1 + n2;
+    const size_t size = (raw + ELOQ_SHM_CMD_ALIGN - 1) & ~(size_t)(ELOQ_SHM_CMD_ALIGN - 1);
+    if (size > ELOQ_SHM_CMD_MAX) return -1;
+
+    size_t off = (size_t)(c.cmdWrite % ELOQ_SHM_CMD_BYTES);
+    const size_t tail = ELOQ_SHM_CMD_BYTES - off;
+    const size_t need = size + (tail < size ? tail : 0);
+    const DWORD start = GetTickCount();
+    while (ELOQ_SHM_CMD_BYTES - (c.cmdWrite - shmLoad(&c.hdr->cmdRead)) < need) {
+        if (!hostAlive(c) || GetTickCount() - start > 2000) return -1;
+        Sleep(1);
+    }
+
+    if (tail < size) {
+        EloqShmCmd pad = { (uint32_t)tail, ELOQ_CMD_PAD, 0, 0 };
+        memcpy(c.hdr->cmd + off, &pad, sizeof(pad));
+        c.cmdWrite += tail;
+        off = 0;
+    }
+    EloqShmCmd h = { (uint32_t)size, type, arg, count };
+    uint8_t* dst = c.hdr->cmd + off;
+    memcpy(dst, &h, sizeof(h));
+    if (n1) memcpy(dst + sizeof(h), p1, n1);
+    if (n2) memcpy(dst + sizeof(h) + n1, p2, n2);
+    c.cmdWrite += size;
+    shmStore(&c.hdr->cmdWrite, c.cmdWrite);
+    SetEvent(c.cmdEvent);
+    return 0;
+}
+
+// Speak and stop start a new epoch; the local wake releases a reader blocked
+// in eloqc_read_batch, which then returns empty like a canceled
+// eloq_read_batch.
+static int postRestart(Client& c, uint32_t type, const char* text) {
+    std::lock_guard<std::mutex> lk(c.mtx);
+    const uint32_t e = c.epoch.fetch_add(1) + 1;
+    const int rc = postCommand(c, type, (int32_t)e, 0, text, text ? strlen(text) + 1 : 0);
+    if (c.dataEvent) SetEvent(c.dataEvent);
+    return rc;
+}
+
+// ------------------------------------------------------------
+// Lifecycle
+// ------------------------------------------------------------
+// Starts eloq_host.exe (hostExe, or the one next to this DLL when null) for
+// the ECI directory and waits up to timeoutMs for its engine to load.
+// Returns 0, -1 on bad arguments or when already open, ELOQC_ERR_*, or the
+// host's failure (an eloq_init code, or ELOQ_SHM_NO_WRAPPER).
+extern "C" ELOQC_API int __cdecl eloqc_open(const wchar_t* hostExe, const wchar_t* eciDir, int timeoutMs) {
+    if (!eciDir) return -1;
+    Client& c = g_client;
+    std::lock_guard<std::mutex> lk(c.mtx);
+    if (c.hdr) return -1;
+
+    static std::atomic<unsigned> seq{0};
+    wchar_t nameBuf[64];
+    swprintf(nameBuf, 64, L"%lu_%u", GetCurrentProcessId(), seq.fetch_add(1));
+    const std::wstring name = nameBuf;
+    const std::wstring base = ELOQ_SHM_PREFIX + name;
+
+    c.section = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0,
+        (DWORD)sizeof(EloqShmHeader), (base + ELOQ_SHM_SECTION).c_str());
+    if (c.section)
+        c.hdr = static_cast<EloqShmHeader*>(MapViewOfFile(c.section, FILE_MAP_ALL_ACCESS, 0, 0,
+            sizeof(EloqShmHeader)));
+    c.cmdEvent = CreateEventW(nullptr, FALSE, FALSE, (base + ELOQ_SHM_CMD_EVENT).c_str());
+    c.dataEvent = CreateEventW(nullptr, FALSE, FALSE, (base + ELOQ_SHM_DATA_EVENT).c_str());
+    c.spaceEvent = CreateEventW(nullptr, FALSE, FALSE, (base + ELOQ_SHM_SPACE_EVENT).c_str());
+    if (!c.hdr || !c.cmdEvent || !c.dataEvent || !c.spaceEvent) {
+        closeHandles(c);
+        return ELOQC_ERR_SHM;
+    }
+    // Fresh sections are zero-filled; only the identity needs writing.
+    c.hdr->magic = ELOQ_SHM_MAGIC;
+    c.hdr->version = ELOQ_SHM_VERSION;
+    c.hdr->clientPid = GetCurrentProcessId();
+
+    const std::wstring exe = hostExe ? std::wstring(hostExe) : clientDir() + L"eloq_host.exe";
+    std::wstring cmdLine = L"\"" + exe + L"\" " + name + L" \"" + eciDir + L"\" " +
+        std::to_wstring(GetCurrentProcessId());
+    STARTUPINFOW si = {};
+    si.cb = sizeof(si);
+    PROCESS_INFORMATION pi = {};
+    if (!CreateProcessW(exe.c_str(), &cmdLine[0], nullptr, nullptr, FALSE, CREATE_NO_WINDOW,
+            nullptr, nullptr, &si, &pi)) {
+        closeHandles(c);
+        return ELOQC_ERR_SPAWN;
+    }
+    CloseHandle(pi.hThread);
+    c.process = pi.hProcess;
+
+    const DWORD start = GetTickCount();
+    HANDLE waits[2] = { c.dataEvent, c.process };
+    while (c.hdr->status == ELOQ_SHM_STARTING) {
+        DWORD wait = INFINITE;
+        if (timeoutMs >= 0) {
+            const DWORD elapsed = GetTickCount() - start;
+            if (elapsed >= (DWORD)timeoutMs) break;
+            wait = (DWORD)timeoutMs - elapsed;
+        }
+        if (WaitForMultipleObjects(2, waits, FALSE, wait) != WAIT_OBJECT_0) break;
+    }
+
+    const int status = c.hdr->status;
+    if (status == ELOQ_SHM_READY) return 0;
+    TerminateProcess(c.process, 1);
+    closeHandles(c);
+    return status < 0 ? status : ELOQC_ERR_TIMEOUT;
+}
+
+// Asks the host to shut down (it frees the engine) and unmaps the rings.
+extern "C" ELOQC_API void __cdecl eloqc_close(void) {
+    Client& c = g_client;
+    std::lock_guard<std::mutex> lk(c.mtx);
+    if (!c.hdr) return;
+    postCommand(c, ELOQ_CMD_QUIT, 0, 0, nullptr, 0);
+    if (WaitForSingleObject(c.process, 3000) != WAIT_OBJECT_0) TerminateProcess(c.process, 1);
+    closeHandles(c);
+}
+
+// 1 = host running, 0 = not open or the host exited.
+extern "C" ELOQC_API int __cdecl eloqc_alive(void) {
+    Client& c = g_client;
+    std::lock_guard<std::mutex> lk(c.mtx);
+    return (c.hdr && hostAlive(c)) ? 1 : 0;
+}
+
+extern "C" ELOQC_API int __cdecl eloqc_format(int* rate, int* bits, int* channels) {
+    const EloqShmHeader* h = g_client.hdr;
+    if (!h || h->sampleRate <= 0) return -1;
+    if (rate) *rate = h->sampleRate;
+    if (bits) *bits = h->bitsPerSample;
+    if (channels) *channels = h->channels;
+    return 0;
+}
+
+// ------------------------------------------------------------
+// Speech and settings
+// ------------------------------------------------------------
+// Text is limited to ELOQ_SHM_CMD_MAX bytes per call (-1 beyond that).
+extern "C" ELOQC_API int __cdecl eloqc_speak(const char* text) {
+    if (!text) return -1;
+    return postRestart(g_client, ELOQ_CMD_SPEAK, text);
+}
+
+extern "C" ELOQC_API int __cdecl eloqc_stop(void) {
+    return postRestart(g_client, ELOQ_CMD_STOP, nullptr);
+}
+
+extern "C" ELOQC_API int __cdecl eloqc_queue(const char* text) {
+    if (!text) return -1;
+    Client& c = g_client;
+    std::lock_guard<std::mutex> lk(c.mtx);
+    return postCommand(c, ELOQ_CMD_QUEUE, 0, 0, text, strlen(text) + 1);
+}
+
+// Same ids as eloq_set_params. Validation happens in the host, so this only
+// reports transport failures: returns n or -1.
+extern "C" ELOQC_API int __cdecl eloqc_set_params(const int* ids, const int* vals, int n) {
+    if (n < 0 || (n > 0 && (!ids || !vals))) return -1;
+    if (n == 0) return 0;
+    Client& c = g_client;
+    std::lock_guard<std::mutex> lk(c.mtx);
+    const size_t bytes = (size_t)n * sizeof(int32_t);
+    const int rc = postCommand(c, ELOQ_CMD_SET_PARAMS, 0, (uint32_t)n, ids, bytes, vals, bytes);
+    return rc == 0 ? n : -1;
+}
+
+// Either path may be null.
+extern "C" ELOQC_API int __cdecl eloqc_load_dict(const char* mainPath, const char* rootPath) {
+    const std::string mainStr = mainPath ? mainPath : "";
+    const std::string rootStr = rootPath ? rootPath : "";
+    Client& c = g_client;
+    std::lock_guard<std::mutex> lk(c.mtx);
+    return postCommand(c, ELOQ_CMD_LOAD_DICT, 0, 0,
+        mainStr.c_str(), mainStr.size() + 1, rootStr.c_str(), rootStr.size() + 1);
+}
+
+// ------------------------------------------------------------
+// Reading
+// ------------------------------------------------------------
+// Drains the rings like readBatchLocked drains the wrapper queue: contiguous
+// audio plus the markers crossed, stopping after DONE/ERROR or when the
+// marker array is full. Without an array markers are consumed and dropped.
+// Everything in front of the current epoch's EPOCH marker is skipped
+// without copying.
+static int readRings(Client& c, uint8_t* buf, int maxBytes,
+    ELOQ_MARKER* markers, int maxMarkers, int* numMarkers) {
+    EloqShmHeader* h = c.hdr;
+    // Markers first: every visible marker then lies at or below audioWrite.
+    const uint64_t mw = shmLoad(&h->markerWrite);
+    const uint64_t aw = shmLoad(&h->audioWrite);
+    const uint32_t want = c.epoch.load();
+    const bool keep = markers && maxMarkers > 0;
+    uint64_t ar = c.audioRead;
+    uint64_t mr = c.markerRead;
+    size_t n = 0;
+    int count = 0;
+    bool full = false;
+
+    while (!full) {
+        while (mr < mw) {
+            const EloqShmMarker& m = h->markers[mr % ELOQ_SHM_MARKERS];
+            if (m.bytePos > ar) break;
+            if (m.type == ELOQ_SHM_EPOCH) {
+                c.seenEpoch = (uint32_t)m.value;
+                mr++;
+                continue;
+            }
+            if (c.seenEpoch != want) {
+                mr++;
+                continue;
+            }
+            if (!keep) {
+                mr++;
+                continue;
+            }
+            if (count >= maxMarkers) {
+                full = true;
+                break;
+            }
+            markers[count].type = m.type;
+            markers[count].value = m.value;
+            markers[count].byteOffset = (int)n;
+            count++;
+            mr++;
+            if (m.type == ELOQ_ITEM_DONE || m.type == ELOQ_ITEM_ERROR) {
+                full = true;
+                break;
+            }
+        }
+        if (full) break;
+
+        uint64_t limit = aw;
+        if (mr < mw) limit = std::min(limit, h->markers[mr % ELOQ_SHM_MARKERS].bytePos);
+        const size_t avail = (size_t)(limit - ar);
+        if (avail == 0) break;
+        if (c.seenEpoch != want) {
+            ar += avail;
+            continue;
+        }
+        const size_t take = std::min(avail, (size_t)maxBytes - n);
+        if (take == 0) break;
+        shmAudioOut(h, ar, buf + n, take);
+        ar += take;
+        n += take;
+    }
+
+    if (ar != c.audioRead || mr != c.markerRead) {
+        c.audioRead = ar;
+        c.markerRead = mr;
+        shmStore(&h->audioRead, ar);
+        shmStore(&h->markerRead, mr);
+        SetEvent(c.spaceEvent);
+    }
+    *numMarkers = count;
+    return (int)n;
+}
+
+// Same contract as eloq_read_batch. If the host dies mid-utterance the
+// reader gets one ERROR marker (value -1), then only empty reads.
+extern "C" ELOQC_API int __cdecl eloqc_read_batch(void* buf, int maxBytes,
+    ELOQ_MARKER* markers, int maxMarkers, int* numMarkers, int timeoutMs) {
+    int localCount = 0;
+    if (!numMarkers) numMarkers = &localCount;
+    *numMarkers = 0;
+
+    Client& c = g_client;
+    if (!c.hdr || !buf || maxBytes < 0 || maxMarkers < 0) return 0;
+
+    const uint32_t epochSnap = c.epoch.load();
+    const DWORD start = GetTickCount();
+    for (;;) {
+        const int n = readRings(c, static_cast<uint8_t*>(buf), maxBytes, markers, maxMarkers, numMarkers);
+        if (n > 0 || *numMarkers > 0) return n;
+
+        if (c.hostLost.load(std::memory_order_relaxed)) {
+            if (!c.lostReported && markers && maxMarkers > 0) {
+                c.lostReported = true;
+                markers[0].type = ELOQ_ITEM_ERROR;
+                markers[0].value = -1;
+                markers[0].byteOffset = 0;
+                *numMarkers = 1;
+                return 0;
+            }
+            if (timeoutMs != 0) Sleep(timeoutMs > 0 ? std::min(timeoutMs, 100) : 100);
+            return 0;
+        }
+        if (timeoutMs == 0 || c.epoch.load() != epochSnap) return 0;
+
+        DWORD wait = INFINITE;
+        if (timeoutMs > 0) {
+            const DWORD elapsed = GetTickCount() - start;
+            if (elapsed >= (DWORD)timeoutMs) return 0;
+            wait = (DWORD)timeoutMs - elapsed;
+        }
+        HANDLE waits[2] = { c.dataEvent, c.process };
+        const DWORD r = WaitForMultipleObjects(2, waits, FALSE, wait);
+        if (r == WAIT_OBJECT_0 + 1) c.hostLost.store(true, std::memory_order_relaxed);
+        else if (r != WAIT_OBJECT_0) return 0;
+    }
+}
@@ -0,0 +1,340 @@
+// eloq_host.cpp
+//
+// Persistent 32-bit synthesis host. Owns eloquence_wrapper.dll and the
+// engine for the lifetime of one client, and serves it over the shared
+// memory transport in eloq_shm.h:
+// - the reader thread calls eloq_read_batch straight into the audio ring and
+//   publishes the markers it returns;
+// - the main thread executes commands from the command ring.
+//
+// Usage (started by eloq_client.dll, not by hand):
+//   eloq_host <name> <eciDir> <clientPid>
+//
+// The host exits on ELOQ_CMD_QUIT or when the client process goes away.
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "eloq_shm.h"
+
+// ------------------------------------------------------------
+// Wrapper ABI (mirrors eloquence_wrapper.cpp)
+// ------------------------------------------------------------
+struct ELOQ_MARKER {
+    int type;
+    int value;
+    int byteOffset;
+};
+
+typedef int  (__cdecl* InitFn)(const wchar_t*);
+typedef void (__cdecl* FreeFn)(void);
+typedef int  (__cdecl* FormatFn)(int*, int*, int*);
+typedef int  (__cdecl* TextFn)(const char*);
+typedef int  (__cdecl* StopFn)(void);
+typedef int  (__cdecl* ReadBatchFn)(void*, int, ELOQ_MARKER*, int, int*, int);
+typedef int  (__cdecl* SetParamsFn)(const int*, const int*, int);
+typedef int  (__cdecl* LoadDictFn)(const char*, const char*);
+
+struct Api {
+    HMODULE dll = nullptr;
+    InitFn init = nullptr;
+    FreeFn release = nullptr;
+    FormatFn format = nullptr;
+    TextFn speak = nullptr;
+    TextFn queue = nullptr;
+    StopFn stop = nullptr;
+    ReadBatchFn readBatch = nullptr;
+    SetParamsFn setParams = nullptr;
+    LoadDictFn loadDict = nullptr;
+};
+
+template <typename T>
+static bool bind(HMODULE m, const char* name, T& fn) {
+    fn = reinterpret_cast<T>(GetProcAddress(m, name));
+    return fn != nullptr;
+}
+
+static std::wstring moduleDir() {
+    wchar_t path[MAX_PATH];
+    DWORD n = GetModuleFileNameW(nullptr, path, MAX_PATH);
+    std::wstring p(path, n);
+    const size_t slash = p.find_last_of(L"\\/");
+    return (slash == std::wstring::npos) ? std::wstring() : p.substr(0, slash + 1);
+}
+
+static bool loadApi(Api& api) {
+    api.dll = LoadLibraryW((moduleDir() + L"eloquence_wrapper.dll").c_str());
+    if (!api.dll) return false;
+    bool ok = true;
+    ok &= bind(api.dll, "eloq_init", api.init);
+    ok &= bind(api.dll, "eloq_free", api.release);
+    ok &= bind(api.dll, "eloq_format", api.format);
+    ok &= bind(api.dll, "eloq_speak", api.speak);
+    ok &= bind(api.dll, "eloq_queue", api.queue);
+    ok &= bind(api.dll, "eloq_stop", api.stop);
+    ok &= bind(api.dll, "eloq_read_batch", api.readBatch);
+    ok &= bind(api.dll, "eloq_set_params", api.setParams);
+    ok &= bind(api.dll, "eloq_load_dict", api.loadDict);
+    return ok;
+}
+
+// ------------------------------------------------------------
+// Host state
+// ------------------------------------------------------------
+struct Host {
+    Api api;
+    EloqShmHeader* hdr = nullptr;
+    HANDLE cmdEvent = nullptr;
+    HANDLE dataEvent = nullptr;
+    HANDLE spaceEvent = nullptr;
+    HANDLE client = nullptr;
+
+    // Own copies of the positions only the host writes.
+    uint64_t audioWrite = 0;
+    uint64_t markerWrite = 0;
+    uint64_t cmdRead = 0;
+
+    // Serializes ring publishing between the reader and speak/stop. While
+    // epochPending is set the reader stays out of eloq_read_batch, so audio
+    // read after the new utterance started always lands behind its EPOCH
+    // marker and audio read before it always lands in front.
+    std::mutex pubMtx;
+    std::condition_variable pubCv;
+    std::atomic<bool> epochPending{false};
+    bool formatPublished = false;
+    std::atomic<bool> running{true};
+};
+
+static HANDLE openEvent(const std::wstring& name, const wchar_t* suffix) {
+    return OpenEventW(EVENT_MODIFY_STATE | SYNCHRONIZE, FALSE,
+        (ELOQ_SHM_PREFIX + name + suffix).c_str());
+}
+
+static void publishFormat(Host& h) {
+    int rate = 0, bits = 0, channels = 0;
+    if (h.api.format(&rate, &bits, &channels) != 0) return;
+    h.hdr->sampleRate = rate;
+    h.hdr->bitsPerSample = bits;
+    h.hdr->channels = channels;
+    h.formatPublished = true;
+}
+
+// Caller holds pubMtx and has checked for space.
+static void writeMarker(Host& h, int type, int value, uint64_t pos) {
+    EloqShmMarker& m = h.hdr->markers[h.markerWrite % ELOQ_SHM_MARKERS];
+    m.type = type;
+    m.value = value;
+    m.bytePos = pos;
+    shmStore(&h.hdr->markerWrite, ++h.markerWrite);
+}
+
+static uint64_t markerSpace(const Host& h) {
+    return ELOQ_SHM_MARKERS - (h.markerWrite - shmLoad(&h.hdr->markerRead));
+}
+
+// Caller holds pubMtx. Waits for the client to free a marker slot; gives up
+// when the host is shutting down.
+static bool pushEpoch(Host& h, int epoch) {
+    while (markerSpace(h) == 0) {
+        if (!h.running.load(std::memory_order_relaxed)) return false;
+        WaitForSingleObject(h.spaceEvent, 5);
+    }
+    writeMarker(h, ELOQ_SHM_EPOCH, epoch, h.audioWrite);
+    SetEvent(h.dataEvent);
+    return true;
+}
+
+// ------------------------------------------------------------
+// Reader thread
+// ------------------------------------------------------------
+static void readerLoop(Host& h) {
+    ELOQ_MARKER marks[64];
+    while (h.running.load(std::memory_order_relaxed)) {
+        std::unique_lock<std::mutex> lk(h.pubMtx);
+        h.pubCv.wait(lk, [&] {
+            return !h.epochPending.load() || !h.running.load(std::memory_order_relaxed);
+        });
+        if (!h.running.load(std::memory_order_relaxed)) break;
+
+        const uint64_t space = ELOQ_SHM_AUDIO_BYTES - (h.audioWrite - shmLoad(&h.hdr->audioRead));
+        const uint64_t mspace = markerSpace(h);
+        if (space == 0 || mspace == 0) {
+            // Client is behind: back-pressure into the wrapper's own queue.
+            lk.unlock();
+            WaitForSingleObject(h.spaceEvent, 20);
+            continue;
+        }
+
+        // Read straight into the ring, up to the wrap point.
+        const size_t off = (size_t)(h.audioWrite % ELOQ_SHM_AUDIO_BYTES);
+        const size_t contig = std::min((size_t)space, (size_t)ELOQ_SHM_AUDIO_BYTES - off);
+        const int maxMarks = (int)std::min<uint64_t>(64, mspace);
+        int numMarks = 0;
+        // Short timeout: a speak/stop cancels the wait anyway, this only
+        // bounds how long QUIT takes to be noticed.
+        const int n = h.api.readBatch(h.hdr->audio + off, (int)contig, marks, maxMarks, &numMarks, 50);
+        if (n <= 0 && numMarks == 0) continue;
+
+        if (!h.formatPublished) publishFormat(h);
+        const uint64_t base = h.audioWrite;
+        if (n > 0) {
+            h.audioWrite += (uint64_t)n;
+            shmStore(&h.hdr->audioWrite, h.audioWrite);
+        }
+        for (int k = 0; k < numMarks; k++)
+            writeMarker(h, marks[k].type, marks[k].value, base + (uint64_t)marks[k].byteOffset);
+        SetEvent(h.dataEvent);
+    }
+}
+
+// ------------------------------------------------------------
+// Commands
+// ------------------------------------------------------------
+// Cancels the current utterance, then (under pubMtx) starts the next one and
+// marks the stream boundary for the client.
+static void restart(Host& h, int epoch, const char* text) {
+    // Set without pubMtx: the reader may hold it inside eloq_read_batch. The
+    // stop wakes that read; once it has published what it holds the reader
+    // parks on pubCv. A read that starts after the stop finds nothing.
+    h.epochPending.store(true);
+    h.api.stop();
+    {
+        std::lock_guard<std::mutex> lk(h.pubMtx);
+        if (text) h.api.speak(text);
+        pushEpoch(h, epoch);
+        h.epochPending.store(false);
+    }
+    h.pubCv.notify_all();
+}
+
+static const char* payloadText(const char* p, size_t len) {
+    return (len > 0 && memchr(p, 0, len)) ? p : nullptr;
+}
+
+// Executes everything in the command ring. Returns false on QUIT or a
+// malformed record.
+static bool drainCommands(Host& h) {
+    const uint64_t end = shmLoad(&h.hdr->cmdWrite);
+    while (h.cmdRead < end) {
+        const size_t off = (size_t)(h.cmdRead % ELOQ_SHM_CMD_BYTES);
+        EloqShmCmd c;
+        memcpy(&c, h.hdr->cmd + off, sizeof(c));
+        // A record must lie inside both the ring and what the client published.
+        if (c.size < sizeof(c) || c.size % ELOQ_SHM_CMD_ALIGN || c.size > ELOQ_SHM_CMD_BYTES - off ||
+            c.size > end - h.cmdRead)
+            return false;
+        const char* p = reinterpret_cast<const char*>(h.hdr->cmd + off + sizeof(c));
+        const size_t len = c.size - sizeof(c);
+
+        switch (c.type) {
+        case ELOQ_CMD_SPEAK:
+            if (const char* text = payloadText(p, len)) restart(h, c.arg, text);
+            break;
+        case ELOQ_CMD_STOP:
+            restart(h, c.arg, nullptr);
+            break;
+        case ELOQ_CMD_QUEUE:
+            if (const char* text = payloadText(p, len)) h.api.queue(text);
+            break;
+        case ELOQ_CMD_SET_PARAMS:
+            // Divided, not multiplied: c.count * 8 wraps in a 32-bit size_t.
+            if (c.count <= len / (2 * sizeof(int32_t))) {
+                const int32_t* ids = reinterpret_cast<const int32_t*>(p);
+                h.api.setParams(ids, ids + c.count, (int)c.count);
+            }
+            break;
+        case ELOQ_CMD_LOAD_DICT:
+            if (const char* mainPath = payloadText(p, len)) {
+                const size_t mainLen = strlen(mainPath) + 1;
+                const char* rootPath = payloadText(p + mainLen, len - mainLen);
+                h.api.loadDict(*mainPath ? mainPath : nullptr,
+                    (rootPath && *rootPath) ? rootPath : nullptr);
+            }
+            break;
+        case ELOQ_CMD_QUIT:
+            return false;
+        default: // PAD and unknown
+            break;
+        }
+        h.cmdRead += c.size;
+        shmStore(&h.hdr->cmdRead, h.cmdRead);
+    }
+    return true;
+}
+
+// ------------------------------------------------------------
+// Entry point
+// ------------------------------------------------------------
+int wmain(int argc, wchar_t** argv) {
+    if (argc < 4) {
+        fprintf(stderr, "usage: eloq_host <name> <eciDir> <clientPid>\n");
+        return 2;
+    }
+    const std::wstring name = argv[1];
+    const wchar_t* eciDir = argv[2];
+    const DWORD clientPid = (DWORD)wcstoul(argv[3], nullptr, 10);
+
+    Host h;
+    HANDLE section = OpenFileMappingW(FILE_MAP_ALL_ACCESS, FALSE,
+        (ELOQ_SHM_PREFIX + name + ELOQ_SHM_SECTION).c_str());
+    if (!section) return 1;
+    h.hdr = static_cast<EloqShmHeader*>(MapViewOfFile(section, FILE_MAP_ALL_ACCESS, 0, 0,
+        sizeof(EloqShmHeader)));
+    h.cmdEvent = openEvent(name, ELOQ_SHM_CMD_EVENT);
+    h.dataEvent = openEvent(name, ELOQ_SHM_DATA_EVENT);
+    h.spaceEvent = openEvent(name, ELOQ_SHM_SPACE_EVENT);
+    h.client = OpenProcess(SYNCHRONIZE, FALSE, clientPid);
+    if (!h.hdr || h.hdr->magic != ELOQ_SHM_MAGIC || h.hdr->version != ELOQ_SHM_VERSION ||
+        !h.cmdEvent || !h.dataEvent || !h.spaceEvent || !h.client)
+        return 1;
+    h.hdr->hostPid = GetCurrentProcessId();
+
+    if (!loadApi(h.api)) {
+        h.hdr->status = ELOQ_SHM_NO_WRAPPER;
+        SetEvent(h.dataEvent);
+        return 1;
+    }
+    const int rc = h.api.init(eciDir);
+    if (rc != 0) {
+        h.hdr->status = rc < 0 ? rc : -1;
+        SetEvent(h.dataEvent);
+        return 1;
+    }
+    publishFormat(h);
+    h.hdr->status = ELOQ_SHM_READY;
+    SetEvent(h.dataEvent);
+
+    std::thread reader(readerLoop, std::ref(h));
+
+    HANDLE waits[2] = { h.cmdEvent, h.client };
+    bool serving = true;
+    while (serving) {
+        const DWORD r = WaitForMultipleObjects(2, waits, FALSE, INFINITE);
+        serving = (r == WAIT_OBJECT_0) && drainCommands(h);
+    }
+
+    h.running.store(false, std::memory_order_relaxed);
+    h.api.stop();
+    h.pubCv.notify_all();
+    reader.join();
+    h.api.release();
+
+    UnmapViewOfFile(h.hdr);
+    CloseHandle(section);
+    CloseHandle(h.cmdEvent);
+    CloseHandle(h.dataEvent);
+    CloseHandle(h.spaceEvent);
+    CloseHandle(h.client);
+    return 0;
+}
@@ -0,0 +1,118 @@
+// eloq_shm.h
+//
+// Shared-memory transport between eloq_host.exe (32-bit, owns the wrapper
+// DLL and the engine) and eloq_client.dll (any bitness). The client creates
+// the section and events, starts the host, and talks to it through:
+// - a command ring (client -> host): length-prefixed records
+// - an audio byte ring plus a marker ring (host -> client), written by
+//   the host straight from eloq_read_batch and read by the client in one copy
+//
+// All three rings are single-producer/single-consumer. Positions are
+// monotonically increasing 64-bit byte/record counts; each side only writes
+// its own positions. The layout uses fixed-width fields only so 32- and
+// 64-bit processes agree on it.
+
+#pragma once
+
+#include <windows.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#define ELOQ_SHM_MAGIC   0x514F4C45u // 'ELOQ'
+#define ELOQ_SHM_VERSION 1u
+
+#define ELOQ_SHM_AUDIO_BYTES (1u << 20) // ~47 s of 11025 Hz 16-bit mono
+#define ELOQ_SHM_MARKERS     4096u
+#define ELOQ_SHM_CMD_BYTES   (64u * 1024u)
+
+// Kernel object names: prefix + instance name + suffix.
+#define ELOQ_SHM_PREFIX L"Local\\eloq_host_"
+#define ELOQ_SHM_SECTION L"_shm"
+#define ELOQ_SHM_CMD_EVENT L"_cmd"     // auto-reset: commands written
+#define ELOQ_SHM_DATA_EVENT L"_data"   // auto-reset: audio/markers/status published
+#define ELOQ_SHM_SPACE_EVENT L"_space" // auto-reset: client consumed audio
+
+// Host status.
+#define ELOQ_SHM_STARTING 0
+#define ELOQ_SHM_READY    1 // negative values: eloq_init failure code
+#define ELOQ_SHM_NO_WRAPPER (-10) // host could not load eloquence_wrapper.dll
+
+// Commands. Record: EloqShmCmd header, then payload; size is the whole
+// record rounded up to 16 bytes. Records never wrap: a PAD record fills the
+// tail of the ring when the next one would not fit.
+#define ELOQ_CMD_PAD        0
+#define ELOQ_CMD_SPEAK      1 // arg = epoch, payload = text
+#define ELOQ_CMD_STOP       2 // arg = epoch
+#define ELOQ_CMD_QUEUE      3 // payload = text
+#define ELOQ_CMD_SET_PARAMS 4 // count = n, payload = int32 ids[n], int32 vals[n]
+#define ELOQ_CMD_LOAD_DICT  5 // payload = main path NUL root path NUL
+#define ELOQ_CMD_QUIT       6
+
+#define ELOQ_SHM_CMD_ALIGN 16u
+#define ELOQ_SHM_CMD_MAX   (ELOQ_SHM_CMD_BYTES / 2) // largest single record
+
+// Host marker carrying the epoch of the speak/stop that produced everything
+// after it. Other marker types are the wrapper's ELOQ_ITEM_* values.
+#define ELOQ_SHM_EPOCH 16
+
+struct EloqShmCmd {
+    uint32_t size;
+    uint32_t type;
+    int32_t arg;
+    uint32_t count;
+};
+
+struct EloqShmMarker {
+    int32_t type;
+    int32_t value;
+    uint64_t bytePos; // audio position the marker follows
+};
+
+struct EloqShmHeader {
+    uint32_t magic;
+    uint32_t version;
+    volatile int32_t status;
+    int32_t sampleRate;
+    int32_t bitsPerSample;
+    int32_t channels;
+    uint32_t clientPid;
+    uint32_t hostPid;
+
+    // Written by the host.
+    volatile uint64_t audioWrite;
+    volatile uint64_t markerWrite;
+    volatile uint64_t cmdRead;
+    // Written by the client.
+    volatile uint64_t audioRead;
+    volatile uint64_t markerRead;
+    volatile uint64_t cmdWrite;
+
+    EloqShmMarker markers[ELOQ_SHM_MARKERS];
+    uint8_t cmd[ELOQ_SHM_CMD_BYTES];
+    uint8_t audio[ELOQ_SHM_AUDIO_BYTES];
+};
+
+static_assert(offsetof(EloqShmHeader, audioWrite) == 32, "shm layout");
+static_assert(offsetof(EloqShmHeader, markers) == 80, "shm layout");
+static_assert(sizeof(EloqShmMarker) == 16, "shm layout");
+
+// 64-bit positions are read and written atomically in 32-bit processes too;
+// both are full barriers, ordering the ring data around them.
+static inline uint64_t shmLoad(const volatile uint64_t* p) {
+    return (uint64_t)InterlockedCompareExchange64(
+        reinterpret_cast<volatile LONG64*>(const_cast<volatile uint64_t*>(p)), 0, 0);
+}
+
+static inline void shmStore(volatile uint64_t* p, uint64_t v) {
+    InterlockedExchange64(reinterpret_cast<volatile LONG64*>(p), (LONG64)v);
+}
+
+// Copies out of the audio ring at an absolute position, splitting at the
+// wrap point.
+static inline void shmAudioOut(const EloqShmHeader* h, uint64_t pos, uint8_t* dst, size_t n) {
+    const size_t off = (size_t)(pos % ELOQ_SHM_AUDIO_BYTES);
+    const size_t first = (n < ELOQ_SHM_AUDIO_BYTES - off) ? n : (ELOQ_SHM_AUDIO_BYTES - off);
+    memcpy(dst, h->audio + off, first);
+    if (n > first) memcpy(dst + first, h->audio, n - first);
+}
@@ -428,6 +428,7 @@ sonicStream sonicCreateStream(int sampleRate, int numChannels) {
   if (!allocateStreamBuffers(stream, sampleRate, numChannels)) {
     return NULL;
   }
+  sonicGetSimdLevel(); /* Select SIMD kernels before first use. */
   stream->speed = 1.0f;
   stream->pitch = 1.0f;
   stream->volume = 1.0f;
@@ -438,6 +439,22 @@ sonicStream sonicCreateStream(int sampleRate, int numChannels) {
   return stream;
 }
 
+/* Drop all buffered input, output and pitch samples, keeping the buffers and
+   the speed/pitch/rate/volume settings, so a stream can be reused for a new
+   utterance without reallocating. */
+void sonicResetStream(sonicStream stream) {
+  stream->numInputSamples = 0;
+  stream->numOutputSamples = 0;
+  stream->numPitchSamples = 0;
+  stream->remainingInputToCopy = 0;
+  stream->oldRatePosition = 0;
+  stream->newRatePosition = 0;
+  stream->prevPeriod = 0;
+  stream->prevMinDiff = 0;
+  stream->inputPlayTime = 0.0f;
+  stream->timeError = 0.0f;
+}
+
 /* Get the sample rate of the stream. */
 int sonicGetSampleRate(sonicStream stream) { return stream->sampleRate; }
 
@@ -742,27 +759,282 @@ static void downSampleInput(sonicStream stream, short* samples, int skip) {
   }
 }
 
+/* Optional SIMD kernels for the two hottest loops: the AMDF sum of absolute
+   differences in findPitchPeriodInRange and the mono overlapAdd ramp.  Both
+   are pure integer (or exactly-rounded) arithmetic, so results match the
+   scalar code bit for bit.  The variant is picked once at runtime by CPUID;
+   define SONIC_NO_SIMD to build the scalar code only. */
+#if !defined(SONIC_NO_SIMD) && \
+    (defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || \
+     defined(__x86_64__))
+#define SONIC_HAVE_X86_SIMD 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define SONIC_TARGET_SSE2
+#define SONIC_TARGET_AVX2
+#else
+/* GCC needs the attribute for SSE2 too: 32-bit targets such as -march=i686
+   do not enable it by default. */
+#include <cpuid.h>
+#define SONIC_TARGET_SSE2 __attribute__((target("sse2")))
+#define SONIC_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define SONIC_HAVE_X86_SIMD 0
+#endif
+
+#define SONIC_SIMD_NONE 0
+#define SONIC_SIMD_SSE2 1
+#define SONIC_SIMD_AVX2 2
+
+/* Sum of |s[i] - p[i]| for i in [0, n), as the scalar AMDF loop computes. */
+static unsigned long amdfScalar(const short* s, const short* p, int n) {
+  unsigned long diff = 0;
+  short sVal, pVal;
+  int i;
+
+  for (i = 0; i < n; i++) {
+    sVal = *s++;
+    pVal = *p++;
+    diff += sVal >= pVal ? (unsigned short)(sVal - pVal)
+                         : (unsigned short)(pVal - sVal);
+  }
+  return diff;
+}
+
+#ifndef SONIC_USE_SIN
+/* out[t] = (d[t]*(n - t) + u[t]*t)/n for mono streams, from t = start. */
+static void overlapAddMonoScalar(int numSamples, short* out,
+                                 const short* rampDown, const short* rampUp,
+                                 int start) {
+  int t;
+
+  for (t = start; t < numSamples; t++) {
+    out[t] = (rampDown[t] * (numSamples - t) + rampUp[t] * t) / numSamples;
+  }
+}
+#endif
+
+#if SONIC_HAVE_X86_SIMD
+
+static int detectSimdLevel(void) {
+  int level = SONIC_SIMD_NONE;
+#if defined(_MSC_VER)
+  int regs[4];
+  __cpuid(regs, 0);
+  if (regs[0] >= 1) {
+    __cpuid(regs, 1);
+    if (regs[3] & (1 << 26)) level = SONIC_SIMD_SSE2;
+    /* AVX2 also needs OSXSAVE and the OS saving YMM state. */
+    if ((regs[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6) {
+      __cpuidex(regs, 7, 0);
+      if (regs[1] & (1 << 5)) level = SONIC_SIMD_AVX2;
+    }
+  }
+#else
+  unsigned int a, b, c, d;
+  if (__get_cpuid(1, &a, &b, &c, &d)) {
+    if (d & (1u << 26)) level = SONIC_SIMD_SSE2;
+    if (c & (1u << 27)) {
+      unsigned int lo, hi;
+      __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+      if ((lo & 6) == 6 && __get_cpuid_count(7, 0, &a, &b, &c, &d) &&
+          (b & (1u << 5))) {
+        level = SONIC_SIMD_AVX2;
+      }
+    }
+  }
+#endif
+  return level;
+}
+
+SONIC_TARGET_SSE2
+static unsigned long amdfSse2(const short* s, const short* p, int n) {
+  __m128i zero = _mm_setzero_si128();
+  __m128i acc = _mm_setzero_si128();
+  int i = 0;
+  unsigned int lanes[4];
+
+  for (; i + 8 <= n; i += 8) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(s + i));
+    __m128i b = _mm_loadu_si128((const __m128i*)(p + i));
+    /* max - min wraps to the exact unsigned 16-bit distance. */
+    __m128i d = _mm_sub_epi16(_mm_max_epi16(a, b), _mm_min_epi16(a, b));
+    acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(d, zero));
+    acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(d, zero));
+  }
+  _mm_storeu_si128((__m128i*)lanes, acc);
+  return (unsigned long)lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+         amdfScalar(s + i, p + i, n - i);
+}
+
+SONIC_TARGET_AVX2
+static unsigned long amdfAvx2(const short* s, const short* p, int n) {
+  __m256i zero = _mm256_setzero_si256();
+  __m256i acc = _mm256_setzero_si256();
+  __m128i acc128;
+  int i = 0;
+  unsigned int lanes[4];
+
+  for (; i + 16 <= n; i += 16) {
+    __m256i a = _mm256_loadu_si256((const __m256i*)(s + i));
+    __m256i b = _mm256_loadu_si256((const __m256i*)(p + i));
+    __m256i d =
+        _mm256_sub_epi16(_mm256_max_epi16(a, b), _mm256_min_epi16(a, b));
+    /* Lane order does not matter for a total. */
+    acc = _mm256_add_epi32(acc, _mm256_unpacklo_epi16(d, zero));
+    acc = _mm256_add_epi32(acc, _mm256_unpackhi_epi16(d, zero));
+  }
+  acc128 = _mm_add_epi32(_mm256_castsi256_si128(acc),
+                         _mm256_extracti128_si256(acc, 1));
+  /* One 8-wide step here (VEX-encoded in this function) rather than handing
+     the tail to the SSE2 kernel, which would pay AVX-SSE transitions. */
+  if (i + 8 <= n) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(s + i));
+    __m128i b = _mm_loadu_si128((const __m128i*)(p + i));
+    __m128i d = _mm_sub_epi16(_mm_max_epi16(a, b), _mm_min_epi16(a, b));
+    __m128i zero128 = _mm256_castsi256_si128(zero);
+    acc128 = _mm_add_epi32(acc128, _mm_unpacklo_epi16(d, zero128));
+    acc128 = _mm_add_epi32(acc128, _mm_unpackhi_epi16(d, zero128));
+    i += 8;
+  }
+  _mm_storeu_si128((__m128i*)lanes, acc128);
+  _mm256_zeroupper();
+  return (unsigned long)lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+         amdfScalar(s + i, p + i, n - i);
+}
+
+/* The weighted sum d*(n-t) + u*t is formed exactly with pmaddwd on
+   interleaved (d, u) and (n-t, t) pairs, which needs n <= 32767.  The
+   division is done in double: the quotient of two integers below 2^31 is
+   either exact or at least 1/n away from the next integer, so truncation
+   gives the same result as C integer division. */
+SONIC_TARGET_SSE2
+static int overlapAddMonoSse2(int numSamples, short* out,
+                              const short* rampDown, const short* rampUp) {
+  __m128d divisor = _mm_set1_pd((double)numSamples);
+  __m128i step = _mm_set_epi16(8, -8, 8, -8, 8, -8, 8, -8);
+  __m128i wLo = _mm_set_epi16(3, numSamples - 3, 2, numSamples - 2, 1,
+                              numSamples - 1, 0, numSamples);
+  __m128i wHi = _mm_set_epi16(7, numSamples - 7, 6, numSamples - 6, 5,
+                              numSamples - 5, 4, numSamples - 4);
+  int t = 0;
+
+  for (; t + 8 <= numSamples; t += 8) {
+    __m128i d = _mm_loadu_si128((const __m128i*)(rampDown + t));
+    __m128i u = _mm_loadu_si128((const __m128i*)(rampUp + t));
+    __m128i sumLo = _mm_madd_epi16(_mm_unpacklo_epi16(d, u), wLo);
+    __m128i sumHi = _mm_madd_epi16(_mm_unpackhi_epi16(d, u), wHi);
+    __m128i q0 = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(sumLo), divisor));
+    __m128i q1 = _mm_cvttpd_epi32(
+        _mm_div_pd(_mm_cvtepi32_pd(_mm_srli_si128(sumLo, 8)), divisor));
+    __m128i q2 = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(sumHi), divisor));
+    __m128i q3 = _mm_cvttpd_epi32(
+        _mm_div_pd(_mm_cvtepi32_pd(_mm_srli_si128(sumHi, 8)), divisor));
+    __m128i lo = _mm_unpacklo_epi64(q0, q1);
+    __m128i hi = _mm_unpacklo_epi64(q2, q3);
+    _mm_storeu_si128((__m128i*)(out + t), _mm_packs_epi32(lo, hi));
+    wLo = _mm_add_epi16(wLo, step);
+    wHi = _mm_add_epi16(wHi, step);
+  }
+  return t;
+}
+
+SONIC_TARGET_AVX2
+static int overlapAddMonoAvx2(int numSamples, short* out,
+                              const short* rampDown, const short* rampUp) {
+  __m256d divisor = _mm256_set1_pd((double)numSamples);
+  __m256i step = _mm256_set_epi16(8, -8, 8, -8, 8, -8, 8, -8, 8, -8, 8, -8, 8,
+                                  -8, 8, -8);
+  /* Pairs for t..t+3 in the low half and t+4..t+7 in the high half, to
+     match the (unpacklo, unpackhi) halves built below. */
+  __m256i w = _mm256_set_epi16(
+      7, numSamples - 7, 6, numSamples - 6, 5, numSamples - 5, 4,
+      numSamples - 4, 3, numSamples - 3, 2, numSamples - 2, 1, numSamples - 1,
+      0, numSamples);
+  int t = 0;
+
+  for (; t + 8 <= numSamples; t += 8) {
+    __m128i d = _mm_loadu_si128((const __m128i*)(rampDown + t));
+    __m128i u = _mm_loadu_si128((const __m128i*)(rampUp + t));
+    __m256i pairs = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_unpacklo_epi16(d, u)),
+        _mm_unpackhi_epi16(d, u), 1);
+    __m256i sum = _mm256_madd_epi16(pairs, w);
+    __m128i q0 = _mm256_cvttpd_epi32(_mm256_div_pd(
+        _mm256_cvtepi32_pd(_mm256_castsi256_si128(sum)), divisor));
+    __m128i q1 = _mm256_cvttpd_epi32(_mm256_div_pd(
+        _mm256_cvtepi32_pd(_mm256_extracti128_si256(sum, 1)), divisor));
+    _mm_storeu_si128((__m128i*)(out + t), _mm_packs_epi32(q0, q1));
+    w = _mm256_add_epi16(w, step);
+  }
+  _mm256_zeroupper();
+  return t;
+}
+
+#else
+
+static int detectSimdLevel(void) { return SONIC_SIMD_NONE; }
+
+#endif /* SONIC_HAVE_X86_SIMD */
+
+typedef unsigned long (*amdfFunc)(const short* s, const short* p, int n);
+typedef int (*overlapAddMonoFunc)(int numSamples, short* out,
+                                  const short* rampDown, const short* rampUp);
+
+static amdfFunc amdfImpl = 0;
+static overlapAddMonoFunc overlapAddMonoImpl = 0;
+static int simdLevel = -1;
+
+/* Point the kernels at the given level.  Racing first calls store identical
+   values. */
+static void useSimdLevel(int level) {
+  amdfImpl = 0;
+  overlapAddMonoImpl = 0;
+#if SONIC_HAVE_X86_SIMD
+  if (level == SONIC_SIMD_AVX2) {
+    amdfImpl = amdfAvx2;
+    overlapAddMonoImpl = overlapAddMonoAvx2;
+  } else if (level == SONIC_SIMD_SSE2) {
+    amdfImpl = amdfSse2;
+    overlapAddMonoImpl = overlapAddMonoSse2;
+  }
+#endif
+  simdLevel = level;
+}
+
+/* Return the SIMD level in use (0 = scalar, 1 = SSE2, 2 = AVX2). */
+int sonicGetSimdLevel(void) {
+  if (simdLevel < 0) {
+    useSimdLevel(detectSimdLevel());
+  }
+  return simdLevel;
+}
+
+/* Force a lower SIMD level, e.g. to A/B benchmark the kernels.  Levels above
+   what the CPU supports are clamped. */
+void sonicSetSimdLevel(int level) {
+  int supported = detectSimdLevel();
+  if (level > supported) {
+    level = supported;
+  }
+  if (level < SONIC_SIMD_NONE) {
+    level = SONIC_SIMD_NONE;
+  }
+  useSimdLevel(level);
+}
+
 /* Find the best frequency match in the range, and given a sample skip multiple.
    For now, just find the pitch of the first channel. */
 static int findPitchPeriodInRange(short* samples, int minPeriod, int maxPeriod,
                                   int* retMinDiff, int* retMaxDiff) {
   int period, bestPeriod = 0, worstPeriod = 255;
-  short* s;
-  short* p;
-  short sVal, pVal;
   unsigned long diff, minDiff = 1, maxDiff = 0;
-  int i;
 
   for (period = minPeriod; period <= maxPeriod; period++) {
-    diff = 0;
-    s = samples;
-    p = samples + period;
-    for (i = 0; i < period; i++) {
-      sVal = *s++;
-      pVal = *p++;
-      diff += sVal >= pVal ? (unsigned short)(sVal - pVal)
-                           : (unsigned short)(pVal - sVal);
-    }
+    diff = amdfImpl ? amdfImpl(samples, samples + period, period)
+                    : amdfScalar(samples, samples + period, period);
     /* Note that the highest number of samples we add into diff will be less
        than 256, since we skip samples.  Thus, diff is a 24 bit number, and
        we can safely multiply by numSamples without overflow */
@@ -864,6 +1136,16 @@ static void overlapAdd(int numSamples, int numChannels, short* out,
   short* d;
   int i, t;
 
+#ifndef SONIC_USE_SIN
+  if (numChannels == 1) {
+    t = 0;
+    if (overlapAddMonoImpl && numSamples <= SHRT_MAX) {
+      t = overlapAddMonoImpl(numSamples, out, rampDown, rampUp);
+    }
+    overlapAddMonoScalar(numSamples, out, rampDown, rampUp, t);
+    return;
+  }
+#endif
   for (i = 0; i < numChannels; i++) {
     o = out + i;
     u = rampUp + i;
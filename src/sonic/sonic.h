@@ -145,6 +145,8 @@ typedef struct sonicStreamStruct* sonicStream;
 sonicStream sonicCreateStream(int sampleRate, int numChannels);
 /* Destroy the sonic stream. */
 void sonicDestroyStream(sonicStream stream);
+/* Drop buffered samples but keep allocations and settings. */
+void sonicResetStream(sonicStream stream);
 /* Attach user data to the stream. */
 void sonicSetUserData(sonicStream stream, void *userData);
 /* Retrieve user data attached to the stream. */
@@ -216,6 +218,13 @@ int sonicGetNumChannels(sonicStream stream);
 /* Set the number of channels.  This will drop any samples that have not been
  * read. */
 void sonicSetNumChannels(sonicStream stream, int numChannels);
+/* Get the SIMD level used for pitch search and overlap-add (0 = scalar,
+   1 = SSE2, 2 = AVX2).  Detected once via CPUID. */
+int sonicGetSimdLevel(void);
+/* Force a SIMD level no higher than the CPU supports.  Output is identical
+   at every level; this exists for benchmarking. */
+void sonicSetSimdLevel(int level);
+
 /* This is a non-stream oriented interface to just change the speed of a sound
    sample.  It works in-place on the sample array, so there must be at least
    speed*numSamples available space in the array. Returns the new number of